@@ -7,7 +7,11 @@
 #include "DSI.h"
 
 #include "MidiHelpers.h"
+#include "MidiController.h"
+#include "Rev2Trace.h"
+#include "Rev2TrafficCapture.h"
 
+#include <algorithm>
 #include <boost/format.hpp>
 
 namespace midikraft {
@@ -83,7 +87,11 @@ namespace midikraft {
 			int versionMajor = data[9]; // This is different from the Rev2 manual, which states that the version is within one byte
 			int versionMinor = data[10];
 			int versionPatch = data[11];
-			versionString_ = (boost::format("%d.%d.%d") % versionMajor % versionMinor % versionPatch).str();
+			std::string version = (boost::format("%d.%d.%d") % versionMajor % versionMinor % versionPatch).str();
+			{
+				std::lock_guard<std::mutex> lock(versionLock_);
+				versionString_ = version;
+			}
 			if (data[1] == 0b01111111) {
 				//Omni seems to be 0b01111111 at DSI
 				return MidiChannel::omniChannel();
@@ -187,9 +195,90 @@ namespace midikraft {
 		//return MidiRPNGenerator::generate(channel().toOneBasedInt(), parameterNo, value, true);
 	}
 
+	std::string DSISynth::versionString() const
+	{
+		std::lock_guard<std::mutex> lock(versionLock_);
+		return versionString_;
+	}
+
+	void DSISynth::sendBlockOfMessagesToSynth(std::string const& midiOutput, std::vector<MidiMessage> const& buffer)
+	{
+		Rev2TraceSpan span("sendBlockOfMessagesToSynth", (int64) buffer.size());
+		auto capture = std::atomic_load(&trafficCapture_);
+		for (auto const &message : buffer) {
+			if (capture) {
+				capture->record(Rev2TrafficCapture::Direction::OUT, message);
+			}
+			messageTransferred(message, true);
+		}
+		Synth::sendBlockOfMessagesToSynth(midiOutput, buffer);
+	}
+
+	void DSISynth::sendToSynth(std::vector<MidiMessage> const &messages)
+	{
+		sendBlockOfMessagesToSynth(midiOutput(), messages);
+	}
+
+	void DSISynth::sendRawToSynth(std::vector<uint8> const &rawMidi)
+	{
+		Rev2TraceSpan span("sendRawToSynth", (int64) rawMidi.size());
+		// The MidiBuffer copies all events into one block of memory, sized up front
+		MidiBuffer buffer;
+		buffer.ensureSize(rawMidi.size() * 4);
+		auto capture = std::atomic_load(&trafficCapture_);
+		size_t position = 0;
+		while (position < rawMidi.size()) {
+			int length = MidiMessage::getMessageLengthFromFirstByte(rawMidi[position]);
+			jassert(rawMidi[position] >= 0x80 && rawMidi[position] < 0xF0 && position + length <= rawMidi.size());
+			if (position + length > rawMidi.size()) break;
+			buffer.addEvent(&rawMidi[position], length, 0);
+			if (capture) {
+				capture->record(Rev2TrafficCapture::Direction::OUT, &rawMidi[position], (size_t)length);
+			}
+			// Short messages fit into the MidiMessage itself, this does not allocate
+			messageTransferred(MidiMessage(&rawMidi[position], length), true);
+			position += (size_t)length;
+		}
+		MidiController::instance()->getMidiOutput(midiOutput())->sendBlockOfMessagesNow(buffer);
+	}
+
+	void DSISynth::setTrafficCapture(std::shared_ptr<Rev2TrafficCapture> capture)
+	{
+		std::atomic_store(&trafficCapture_, capture);
+	}
+
+	void DSISynth::recordIncoming(MidiMessage const &message)
+	{
+		auto capture = std::atomic_load(&trafficCapture_);
+		if (capture) {
+			capture->record(Rev2TrafficCapture::Direction::IN, message);
+		}
+		messageTransferred(message, false);
+	}
+
+	void DSISynth::messageTransferred(MidiMessage const &message, bool outgoing)
+	{
+		ignoreUnused(message, outgoing);
+	}
+
 	Synth::PatchData DSISynth::unescapeSysex(const uint8 *sysExData, int sysExLen, int expectedLength)
 	{
-		PatchData result;
+		// This is do work around a bug in the Rev2 firmware 1.1 that made the program edit buffer dump sent 3 bytes short, which is  bytes less after un-escaping
+		PatchData result(std::max(unescapedSize(sysExLen), (size_t)std::max(expectedLength, 0)));
+		unescapeSysexInto(sysExData, sysExLen, result.data(), result.size());
+		return result;
+	}
+
+	size_t DSISynth::unescapedSize(int sysExLen)
+	{
+		// Every group of up to 8 bytes starts with the byte carrying the most significant bits of the others
+		if (sysExLen <= 0) return 0;
+		return (size_t)(sysExLen / 8) * 7 + (sysExLen % 8 > 0 ? sysExLen % 8 - 1 : 0);
+	}
+
+	size_t DSISynth::unescapeSysexInto(const uint8 *sysExData, int sysExLen, uint8 *destination, size_t destinationSize)
+	{
+		size_t written = 0;
 		int dataIndex = 0;
 		while (dataIndex < sysExLen) {
 			uint8 ms_bits = sysExData[dataIndex];
@@ -197,17 +286,14 @@ namespace midikraft {
 			for (int i = 0; i < 7; i++) {
 				// Actually, the last 7 byte block might be incomplete, as the original number of data bytes might not be a
 				// multitude of 7. Instead of buffering with 0, the DSI folks terminate the block with less than 7 bytes
-				if (dataIndex < sysExLen) {
-					result.push_back(sysExData[dataIndex] | ((ms_bits & (1 << i)) << (7 - i)));
+				if (dataIndex < sysExLen && written < destinationSize) {
+					destination[written++] = (uint8)(sysExData[dataIndex] | ((ms_bits & (1 << i)) << (7 - i)));
 				}
 				dataIndex++;
 			}
 		}
-		// This is do work around a bug in the Rev2 firmware 1.1 that made the program edit buffer dump sent 3 bytes short, which is  bytes less after un-escaping
-		while (result.size() < (size_t)expectedLength) {
-			result.push_back(0);
-		}
-		return result;
+		std::fill(destination + written, destination + destinationSize, (uint8)0);
+		return written;
 	}
 
 	std::vector<juce::uint8> DSISynth::escapeSysex(const PatchData &programEditBuffer, size_t bytesToEscape)
@@ -282,7 +368,7 @@ namespace midikraft {
 					jassert(false);
 				}
 				SimpleLogger::instance()->postMessage("Setting " + def.typedNamedValue.name() + " to " + valueText);				
-				synth_->sendBlockOfMessagesToSynth(synth_->midiOutput(), messages);
+				synth_->sendToSynth(messages);
 				return;
 			}
 		}
@@ -16,8 +16,13 @@
 
 #include "TypedNamedValue.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace midikraft {
 
+	class Rev2TrafficCapture;
+
 	// Global constants
 	extern std::map<int, std::string> kDSIAlternateTunings();
 
@@ -71,17 +76,44 @@ namespace midikraft {
 		// Implement this to get the common global settings implementation working
 		virtual std::vector<DSIGlobalSettingDefinition> dsiGlobalSettings() const = 0;
 
+		// Firmware version as reported in the device detect reply, empty if not detected yet
+		std::string versionString() const;
+
+		// The lowest send path of this class, every block sent by the functions below ends here: it records the capture, the traffic
+		// metrics and a trace span, then hands over to Synth. This hides the Synth function instead of overriding it, so blocks the
+		// host or librarian send through a Synth pointer (bank requests, program dumps) bypass it and are not captured or counted
+		void sendBlockOfMessagesToSynth(std::string const& midiOutput, std::vector<MidiMessage> const& buffer);
+		// Sends to the synth's MIDI output
+		void sendToSynth(std::vector<MidiMessage> const &messages);
+		// Sends a buffer of complete short MIDI messages back to back (no sysex), with a single call to the MIDI output
+		void sendRawToSynth(std::vector<uint8> const &rawMidi);
+
+		// While a capture is set, everything sent by the functions above is recorded. The host records the incoming side by calling
+		// recordIncoming() from its MIDI input callback, the Rev2DeviceManager does that for its devices. Messages the host only
+		// passes to a Rev2DeviceDetector are not recorded. nullptr stops recording
+		void setTrafficCapture(std::shared_ptr<Rev2TrafficCapture> capture);
+		// Call this for every message received from the synth, it feeds the capture and messageTransferred()
+		void recordIncoming(MidiMessage const &message);
+
 	protected:
 		DSISynth(uint8 midiModelID);
 
-		std::vector<MidiMessage> createNRPN(int parameterNo, int value);
+		virtual std::vector<MidiMessage> createNRPN(int parameterNo, int value);
+		// Called for every message actually sent by the send functions above, or passed to recordIncoming(). Does nothing by default
+		virtual void messageTransferred(MidiMessage const &message, bool outgoing);
 		static PatchData unescapeSysex(const uint8 *sysExData, int sysExLen, int expectedLength);
+		// Same as unescapeSysex, but decodes into a buffer of the caller and pads it with 0. Returns the number of bytes decoded
+		static size_t unescapeSysexInto(const uint8 *sysExData, int sysExLen, uint8 *destination, size_t destinationSize);
+		static size_t unescapedSize(int sysExLen);
 		static std::vector<uint8> escapeSysex(const PatchData &programEditBuffer, size_t bytesToEscape);
 
 		uint8 midiModelID_;
+		// These are written from the MIDI and device worker threads, and read from the UI
+		mutable std::mutex versionLock_;
 		std::string versionString_;
-		bool localControl_;
-		bool midiControl_;
+		std::atomic<bool> localControl_;
+		std::atomic<bool> midiControl_;
+		std::shared_ptr<Rev2TrafficCapture> trafficCapture_; // Only accessed with std::atomic_load and std::atomic_store
 
 		// This listener implements sending update messages via NRPN when any of the global settings is changed via the UI
 		class GlobalSettingsListener : public ValueTree::Listener {
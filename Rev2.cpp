@@ -11,28 +11,37 @@
 #include "Rev2Patch.h"
 
 #include <algorithm>
+#include <array>
 #include <boost/format.hpp>
 
 #include "MidiHelpers.h"
 #include "TypedNamedValue.h"
 #include "MidiTuning.h"
 #include "MTSFile.h"
+#include "Rev2Trace.h"
+#include "Rev2ParamLayout.h"
+#include "Rev2BankValidator.h"
+#include "Rev2NrpnTemplates.h"
+
+#include "BinaryResources.h"
 
 namespace midikraft {
 
 	// Definitions for the SysEx format we need
-	const size_t cGatedSeqOnIndex = 139;
-	const size_t cGatedSeqDestination = 111;
-	const size_t cGatedSeqIndex = 140;
-	const size_t cStepSeqNote1Index = 256;
-	const size_t cStepSeqVelocity1Index = 320;
-	const size_t cLayerB = 2048 / 2;
-	const size_t cABMode = 231;
-	const size_t cBpmTempo = 130;
-	const size_t cClockDivide = 131;
+	const size_t cGatedSeqOnIndex = Rev2ParamLayout::sysexIndex<Rev2Param::SeqMode>();
+	const size_t cGatedSeqDestination = Rev2ParamLayout::sysexIndex<Rev2Param::Seq1Dest>();
+	const size_t cGatedSeqIndex = Rev2ParamLayout::sysexIndex<Rev2Param::SeqTrack1>();
+	const size_t cStepSeqNote1Index = Rev2ParamLayout::sysexIndex<Rev2Param::PolySeqNote1>();
+	const size_t cStepSeqVelocity1Index = Rev2ParamLayout::sysexIndex<Rev2Param::PolySeqVel1>();
+	const size_t cLayerB = kSysexStartLayerB;
+	const size_t cABMode = Rev2ParamLayout::sysexIndex<Rev2Param::ABMode>();
+	const size_t cBpmTempo = Rev2ParamLayout::sysexIndex<Rev2Param::BPMTempo>();
+	const size_t cClockDivide = Rev2ParamLayout::sysexIndex<Rev2Param::ClockDivide>();
 
 	// Some constants
 	const uint8 cDefaultNote = 0x3c;
+	const int kParamReceiveNRPN = 4102;
+	const int kSelectLayerNRPN = 4190;
 
 	std::vector<Range<int>> kRev2BlankOutZones = {
 		{ 211, 231 }, // unused according to doc
@@ -42,6 +51,18 @@ namespace midikraft {
 		{ 2044, 2047} // the two bytes that are wrongly not encoded (firmware bug), and two bytes that are only buffered to get to clean 2048 size
 	};
 
+	class Rev2GlobalSettingsDataFile : public DataFile {
+	public:
+		using DataFile::DataFile;
+
+		virtual std::string name() const override;
+	};
+
+	std::string Rev2GlobalSettingsDataFile::name() const
+	{
+		return "Rev2 Global Settings";
+	}
+
 	std::string intervalToText(int interval) {
 		if (interval == 0) {
 			return "same note";
@@ -64,7 +85,8 @@ namespace midikraft {
 		}
 	}
 
-	Rev2::Rev2() : DSISynth(0x2f /* Rev2 ID */)
+	Rev2::Rev2() : DSISynth(0x2f /* Rev2 ID */), programCache_(std::make_shared<Rev2ProgramCache>()), metrics_(std::make_shared<Rev2Metrics>()),
+		paramReceiveMode_((int) ParamReceiveMode::NRPN), selectedLayer_(-1)
 	{
 		initGlobalSettings();
 	}
@@ -86,6 +108,49 @@ namespace midikraft {
 		}
 	}
 
+	uint64 Rev2::voiceFingerprint(const uint8 *data, size_t size)
+	{
+		// Same zones as in filterVoiceRelevantData, as a lookup table
+		static const std::vector<bool> kRelevant = []() {
+			std::vector<bool> result(2048, true);
+			for (auto const &zone : kRev2BlankOutZones) {
+				for (int i = zone.getStart(); i < zone.getEnd(); i++) {
+					result[i] = false;
+				}
+			}
+			return result;
+		}();
+		// Only the first 2046 bytes are transmitted, patches might be buffered to 2048 bytes or not
+		size = std::min(size, (size_t)2046);
+		uint64 hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < size; i++) {
+			if (i < kRelevant.size() && !kRelevant[i]) continue;
+			hash = (hash ^ data[i]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	uint64 Rev2::voiceFingerprint(Synth::PatchData const &data)
+	{
+		return voiceFingerprint(data.data(), data.size());
+	}
+
+	uint64 Rev2::contentFingerprint(const uint8 *data, size_t size)
+	{
+		// Bytes 2044 and 2045 are transmitted, but don't survive the round trip, see kRev2BlankOutZones
+		size = std::min(size, (size_t)2044);
+		uint64 hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ data[i]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	uint64 Rev2::contentFingerprint(Synth::PatchData const &data)
+	{
+		return contentFingerprint(data.data(), data.size());
+	}
+
 	std::vector<midikraft::DataFileLoadCapability::DataFileImportDescription> Rev2::dataFileImportChoices() const
 	{
 		std::vector<midikraft::DataFileLoadCapability::DataFileImportDescription> result;
@@ -118,13 +183,42 @@ namespace midikraft {
 
 	std::string Rev2::friendlyBankName(MidiBankNumber bankNo) const
 	{
-		int section = bankNo.toZeroBased() / 4;
+		static const std::array<std::string, 8> kBankNames = []() {
+			std::array<std::string, 8> result;
+			for (int bank = 0; bank < 8; bank++) {
+				int section = bank / 4;
+				result[bank] = (boost::format("%s%d") % (section == 0 ? "U" : "F") % ((bank % 4) + 1)).str();
+			}
+			return result;
+		}();
 		int bank = bankNo.toZeroBased();
-		return (boost::format("%s%d") % (section == 0 ? "U" : "F") % ((bank % 4) + 1)).str();
+		jassert(bank >= 0 && bank < (int)kBankNames.size());
+		return kBankNames[(size_t)std::min(std::max(bank, 0), (int)kBankNames.size() - 1)];
+	}
+
+	// Bulk loads log one line per bank, not one per program
+	static void logOutOfRangePatches(size_t numberOutOfRange, size_t numberOfPatches)
+	{
+		if (numberOutOfRange > 0) {
+			SimpleLogger::instance()->postMessage((boost::format("Warning: %d of %d Rev2 programs have values out of range, the dumps might be truncated or corrupt")
+				% numberOutOfRange % numberOfPatches).str());
+		}
 	}
 
 	std::shared_ptr<DataFile> Rev2::patchFromSysex(const MidiMessage& message) const
 	{
+		bool inRange = true;
+		auto patch = decodeDump(message, inRange);
+		if (patch && !inRange) {
+			std::string what = isSingleProgramDump(message) ? "program " + friendlyProgramName(getProgramNumber(message)) : "edit buffer";
+			SimpleLogger::instance()->postMessage((boost::format("Warning: Rev2 %s has values out of range, the dump might be truncated or corrupt") % what).str());
+		}
+		return patch;
+	}
+
+	std::shared_ptr<DataFile> Rev2::decodeDump(const MidiMessage& message, bool &inRange) const
+	{
+		Rev2TraceSpan span("decode");
 		int startIndex = -1;
 
 		if (isEditBufferDump(message)) {
@@ -143,43 +237,110 @@ namespace midikraft {
 
 		// Decode the data
 		const uint8 *startOfData = &message.getSysExData()[startIndex];
-		auto patchData = unescapeSysex(startOfData, message.getSysExDataSize() - startIndex, 2048);
+		Synth::PatchData patchData;
+		{
+			Rev2Metrics::ScopedTimer timer(metrics_->decodeTime());
+			patchData = unescapeSysex(startOfData, message.getSysExDataSize() - startIndex, 2048);
+		}
 		MidiProgramNumber place;
 		if (isSingleProgramDump(message)) {
 			int bank = message.getSysExData()[3];
 			int program = message.getSysExData()[4];
 			place = MidiProgramNumber::fromZeroBase(bank * 128 + program);
 		}
+		inRange = Rev2BankValidator::isValid(patchData);
 		auto patch = std::make_shared<Rev2Patch>(patchData, place);
 
 		return patch;
 	}
 
 	std::shared_ptr<DataFile> Rev2::patchFromPatchData(const Synth::PatchData &data, MidiProgramNumber place) const {
-		ignoreUnused(place);
-
-		//TODO - this is a hack. We should only store MIDI messages in the database, should we?
-		// Recreate a MIDI message from the bytes given, and test if it is a valid datafile...
-		auto message = MidiMessage::createSysExMessage(data.data(), (int) data.size());
-		if (isPartOfDataFileStream(message, DataStreamType(GLOBAL_SETTINGS))) {
-			auto result = loadData({ message }, DataStreamType(GLOBAL_SETTINGS));
-			return result[0];
-		}
-		else if (isDataFile(message, DataFileType(ALTERNATE_TUNING))) {
+		switch (classifyPatchData(data.data(), data.size()).asInt()) {
+		case GLOBAL_SETTINGS:
+			return std::make_shared<Rev2GlobalSettingsDataFile>(GLOBAL_SETTINGS, data);
+		case ALTERNATE_TUNING: {
+			// Rare enough to go through the full MTS validation in loadData
+			auto message = MidiMessage::createSysExMessage(data.data(), (int)data.size());
 			auto result = loadData({ message }, DataStreamType(ALTERNATE_TUNING));
-			return result[0];
+			if (!result.empty()) {
+				return result[0];
+			}
+			break;
+		}
+		default:
+			break;
 		}
-
 		return std::make_shared<Rev2Patch>(data, place);
 	}
 
+	std::vector<std::shared_ptr<DataFile>> Rev2::patchesFromPatchData(std::vector<Synth::PatchData> const &data, std::vector<MidiProgramNumber> const &places) const
+	{
+		jassert(data.size() == places.size());
+		std::vector<std::shared_ptr<DataFile>> result;
+		result.reserve(data.size());
+		for (size_t i = 0; i < data.size(); i++) {
+			result.push_back(patchFromPatchData(data[i], i < places.size() ? places[i] : MidiProgramNumber::fromZeroBase(0)));
+		}
+		return result;
+	}
+
+	Rev2Bank Rev2::loadBank(std::vector<MidiMessage> const &messages) const
+	{
+		Rev2TraceSpan span("loadBank", (int64)messages.size());
+		Rev2Bank bank(messages.size());
+		size_t outOfRange = 0;
+		for (auto const &message : messages) {
+			int startIndex;
+			MidiProgramNumber place = MidiProgramNumber::fromZeroBase(0);
+			if (isSingleProgramDump(message)) {
+				startIndex = 5;
+				place = getProgramNumber(message);
+			}
+			else if (isEditBufferDump(message)) {
+				startIndex = 3;
+			}
+			else {
+				continue;
+			}
+			uint8 *destination = bank.appendUninitialized(place);
+			{
+				Rev2Metrics::ScopedTimer timer(metrics_->decodeTime());
+				unescapeSysexInto(&message.getSysExData()[startIndex], message.getSysExDataSize() - startIndex, destination, Rev2Bank::kPatchSize);
+			}
+			if (!Rev2BankValidator::isValid(destination)) {
+				outOfRange++;
+			}
+		}
+		logOutOfRangePatches(outOfRange, bank.size());
+		return bank;
+	}
+
+	DataFileType Rev2::classifyPatchData(const uint8 *data, size_t size) const
+	{
+		// These are the same tests isDataFile() does on the MidiMessage, just done on the bytes
+		if (size > 2 && data[0] == 0x01 /* DSI */ && data[1] == midiModelID_ && data[2] == 0b00001111 /* Main Parameter Data*/) {
+			return DataFileType(GLOBAL_SETTINGS);
+		}
+		if (size > 3 && (data[0] == 0x7e || data[0] == 0x7f) && data[2] == 0x08 /* MIDI Tuning Standard */) {
+			// Only a candidate, but a patch can't start like this as Osc 1 Freq only goes up to 120
+			auto message = MidiMessage::createSysExMessage(data, (int)size);
+			if (MidiTuning::isTuningDump(message)) {
+				return DataFileType(ALTERNATE_TUNING);
+			}
+		}
+		return DataFileType(PATCH);
+	}
 
 	std::vector<juce::MidiMessage> Rev2::patchToSysex(std::shared_ptr<DataFile> patch) const
 	{
 		// By default, create an edit buffer dump file...
 		std::vector<uint8> programEditBufferDataDump({ 0x01 /* DSI */, midiModelID_, 0x03 /* Edit Buffer Data */ });
 		jassert(patch->data().size() == 2046 || patch->data().size() == 2048); // Original size is 2046, but to find some programming errors at some points I buffer to 2048
-		auto patchData = escapeSysex(patch->data(), 2046);
+		std::vector<uint8> patchData;
+		{
+			Rev2Metrics::ScopedTimer timer(metrics_->encodeTime());
+			patchData = escapeSysex(patch->data(), 2046);
+		}
 		jassert(patchData.size() == 2339);
 		std::copy(patchData.begin(), patchData.end(), std::back_inserter(programEditBufferDataDump));
 		return std::vector<MidiMessage>({ MidiHelpers::sysexMessage(programEditBufferDataDump) });
@@ -207,7 +368,11 @@ namespace midikraft {
 
 	juce::MidiMessage Rev2::buildSysexFromEditBuffer(std::vector<uint8> editBuffer) {
 		// Done, now create a new encoded buffer
-		std::vector<uint8> encodedBuffer = escapeSysex(editBuffer, 2046);
+		std::vector<uint8> encodedBuffer;
+		{
+			Rev2Metrics::ScopedTimer timer(metrics_->encodeTime());
+			encodedBuffer = escapeSysex(editBuffer, 2046);
+		}
 
 		// Build the sysex method with the patched buffer
 		std::vector<uint8> sysEx({ 0b00000001, 0b00101111, 0b00000011 });
@@ -279,6 +444,25 @@ namespace midikraft {
 		});
 	}
 
+	// All bytes that make up the sequences of a program, for both layers. Ranges are [start, end)
+	static const std::vector<Range<size_t>> kSequencerLockZones = {
+		// Poly sequence, 6 tracks with 64 bytes for note and 64 bytes for velocity each
+		{ cStepSeqNote1Index, cStepSeqNote1Index + 6 * 64 * 2 },
+		{ cLayerB + cStepSeqNote1Index, cLayerB + cStepSeqNote1Index + 6 * 64 * 2 },
+		// 4 tracks with 16 bytes each for the gated sequencer
+		{ cGatedSeqIndex, cGatedSeqIndex + 4 * 16 },
+		{ cLayerB + cGatedSeqIndex, cLayerB + cGatedSeqIndex + 4 * 16 },
+		// For the gated to work as expected, take over the switch as well which of the sequencers is on (poly or gated),
+		// and we need the gated destination for track 1 to be osc all frequencies
+		{ cGatedSeqOnIndex, cGatedSeqOnIndex + 1 },
+		{ cGatedSeqDestination, cGatedSeqDestination + 1 },
+		{ cLayerB + cGatedSeqOnIndex, cLayerB + cGatedSeqOnIndex + 1 },
+		{ cLayerB + cGatedSeqDestination, cLayerB + cGatedSeqDestination + 1 },
+		// Also copy over tempo and clock
+		{ cBpmTempo, cClockDivide + 1 },
+		{ cLayerB + cBpmTempo, cLayerB + cClockDivide + 1 },
+	};
+
 	juce::MidiMessage Rev2::copySequencersFromOther(const MidiMessage& currentProgram, const MidiMessage &lockedProgram)
 	{
 		// Decode locked data as well
@@ -286,82 +470,123 @@ namespace midikraft {
 		const uint8 *startOfData = &lockedProgram.getSysExData()[3];
 		std::vector<uint8> lockedProgramBufferDecoded = unescapeSysex(startOfData, lockedProgram.getSysExDataSize() - 3, 2048);
 		return filterProgramEditBuffer(currentProgram, [lockedProgramBufferDecoded](std::vector<uint8> &programEditBuffer) {
-			// Copy poly sequence of both layers, 6 tracks with 64 bytes for note and 64 bytes for velocity each!
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cStepSeqNote1Index),
-				std::next(lockedProgramBufferDecoded.begin(), cStepSeqNote1Index + 6 * 64 * 2),
-				std::next(programEditBuffer.begin(), cStepSeqNote1Index));
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cLayerB + cStepSeqNote1Index),
-				std::next(lockedProgramBufferDecoded.begin(), cLayerB + cStepSeqNote1Index + 6 * 64 * 2),
-				std::next(programEditBuffer.begin(), cLayerB + cStepSeqNote1Index));
-
-			// Copy 4 tracks with 16 bytes each for the gated sequencer
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cGatedSeqIndex),
-				std::next(lockedProgramBufferDecoded.begin(), cGatedSeqIndex + 4 * 16),
-				std::next(programEditBuffer.begin(), cGatedSeqIndex));
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cLayerB + cGatedSeqIndex),
-				std::next(lockedProgramBufferDecoded.begin(), cLayerB + cGatedSeqIndex + 4 * 16),
-				std::next(programEditBuffer.begin(), cLayerB + cGatedSeqIndex));
-
-			// For the gated to work as expected, take over the switch as well which of the sequencers is on (poly or gated),
-			// and we need the gated destination for track 1 to be osc all frequencies
-			programEditBuffer[cGatedSeqOnIndex] = lockedProgramBufferDecoded[cGatedSeqOnIndex];
-			programEditBuffer[cGatedSeqDestination] = lockedProgramBufferDecoded[cGatedSeqDestination];
-			programEditBuffer[cLayerB + cGatedSeqOnIndex] = lockedProgramBufferDecoded[cLayerB + cGatedSeqOnIndex];
-			programEditBuffer[cLayerB + cGatedSeqDestination] = lockedProgramBufferDecoded[cLayerB + cGatedSeqDestination];
-
-			// Also copy over tempo and clock
-			programEditBuffer[cBpmTempo] = lockedProgramBufferDecoded[cBpmTempo];
-			programEditBuffer[cClockDivide] = lockedProgramBufferDecoded[cClockDivide];
-			programEditBuffer[cLayerB + cBpmTempo] = lockedProgramBufferDecoded[cLayerB + cBpmTempo];
-			programEditBuffer[cLayerB + cClockDivide] = lockedProgramBufferDecoded[cLayerB + cClockDivide];
+			for (auto const &zone : kSequencerLockZones) {
+				std::copy(std::next(lockedProgramBufferDecoded.begin(), zone.getStart()),
+					std::next(lockedProgramBufferDecoded.begin(), zone.getEnd()),
+					std::next(programEditBuffer.begin(), zone.getStart()));
+			}
 		});
 	}
 
+	Rev2::SequencerSplice Rev2::prepareSequencerSplice(const MidiMessage &lockedProgram) const
+	{
+		SequencerSplice result;
+		if (!isEditBufferDump(lockedProgram)) {
+			jassert(false);
+			return result;
+		}
+
+		// The escaping packs 7 data bytes behind one msb byte, so decoded byte i lives in group i / 7 at position i % 7
+		const uint8 *escaped = &lockedProgram.getSysExData()[3];
+		size_t escapedLength = (size_t) (lockedProgram.getSysExDataSize() - 3);
+		std::map<size_t, uint8> masks;
+		for (auto const &zone : kSequencerLockZones) {
+			for (size_t i = zone.getStart(); i < zone.getEnd(); i++) {
+				masks[i / 7] |= (uint8) (1 << (i % 7));
+			}
+		}
+
+		for (auto const &mask : masks) {
+			SequencerSplice::Group group = { mask.first, mask.second, { 0 } };
+			size_t groupStart = mask.first * 8;
+			if (groupStart >= escapedLength) {
+				// The last bytes of layer B are not transmitted, see escapeSysex(data, 2046)
+				break;
+			}
+			std::copy(escaped + groupStart, escaped + std::min(groupStart + 8, escapedLength), group.bytes);
+			result.groups.push_back(group);
+		}
+		return result;
+	}
+
+	juce::MidiMessage Rev2::spliceSequencers(const MidiMessage &currentProgram, SequencerSplice const &splice) const
+	{
+		if (!isEditBufferDump(currentProgram)) {
+			jassert(false);
+			return MidiMessage(); // Empty sysex message so it doesn't crash
+		}
+
+		// Copy the still escaped sysex, and only replace the bytes we have prepared
+		std::vector<uint8> sysEx(currentProgram.getSysExData(), currentProgram.getSysExData() + currentProgram.getSysExDataSize());
+		uint8 *escaped = &sysEx[3];
+		size_t escapedLength = sysEx.size() - 3;
+		for (auto const &group : splice.groups) {
+			size_t groupStart = group.groupIndex * 8;
+			if (groupStart >= escapedLength) continue;
+			size_t groupLength = std::min((size_t) 8, escapedLength - groupStart);
+			if (group.mask == 0x7f) {
+				std::copy(group.bytes, group.bytes + groupLength, escaped + groupStart);
+			}
+			else {
+				escaped[groupStart] = (uint8) ((escaped[groupStart] & ~group.mask) | (group.bytes[0] & group.mask));
+				for (size_t i = 0; i < 7 && i + 1 < groupLength; i++) {
+					if (group.mask & (1 << i)) {
+						escaped[groupStart + 1 + i] = group.bytes[1 + i];
+					}
+				}
+			}
+		}
+		return MidiMessage::createSysExMessage(sysEx.data(), (int)sysEx.size());
+	}
+
 	void Rev2::switchToLayer(int layerNo)
 	{
 		if (wasDetected()) {
 			// The Rev2 has only two layers, A and B
 			// Which of the layers is played is not part of the patch data, but is a global setting/parameter. Luckily, this can be switched via an NRPN message
 			// The DSI synths like MSB before LSB
-			auto messages = MidiHelpers::generateRPN(channel().toOneBasedInt(), 4190, layerNo, true, true, true);
-			sendBlockOfMessagesToSynth(midiOutput(), messages);
+			sendToSynth(createNRPN(kSelectLayerNRPN, layerNo));
 		}
 	}
 
 	std::vector<MidiMessage> Rev2::layerToSysex(std::shared_ptr<DataFile> const patch, int sourceLayer, int targetLayer) const
 	{
-		ignoreUnused(targetLayer);
+		Rev2TraceSpan span("layerToSysex", targetLayer);
 		std::vector<MidiMessage> allMessages;
 		// Now, these will be a lot of NRPN messages generated, but what we can do is to generate a layer change by settings all values of all parameters via NRPN
 		auto rev2patch = std::dynamic_pointer_cast<Rev2Patch>(patch);
 		if (rev2patch) {
-			// Loop all parameters, and create set value messages for them
-			int count = 0;
-			for (const auto& param : rev2patch->allParameterDefinitions()) {
-				count++;
-				if (count > 88) break;
-				auto rev2param = std::dynamic_pointer_cast<Rev2ParamDefinition>(param);
-				if (rev2param) {
-					rev2param->setSourceLayer(sourceLayer);
-					rev2param->setTargetLayer(targetLayer);
-					auto p = std::dynamic_pointer_cast<Patch>(patch);
-					if (p) {
-						auto setcommand = rev2param->setValueMessages(p, this);
-						std::copy(setcommand.cbegin(), setcommand.cend(), std::back_inserter(allMessages));
-					}
-				}
+			// Loop the first 88 parameters with the shared definitions, and create set value messages for them
+			auto const &definitions = Rev2Patch::parameterDefinitions();
+			size_t count = std::min(definitions.size(), (size_t) 88);
+			for (size_t i = 0; i < count; i++) {
+				auto setcommand = definitions[i].setValueMessages(*rev2patch, channel(), sourceLayer, targetLayer);
+				std::copy(setcommand.cbegin(), setcommand.cend(), std::back_inserter(allMessages));
 			}
 		}
+		// Every NRPN is made up of 4 controller messages
+		metrics_->countGeneratedNRPNs(allMessages.size() / 4);
 		return allMessages;
 	}
 
+	std::vector<uint8> Rev2::layerToRawNRPN(DataFile const &patch, int sourceLayer, int targetLayer) const
+	{
+		Rev2TraceSpan span("layerToRawNRPN", targetLayer);
+		std::vector<uint8> rawMidi;
+		// At most one NRPN per byte of the layer, so the buffer is allocated once
+		rawMidi.reserve(kSysexStartLayerB * Rev2NrpnTemplates::kBytesPerNRPN);
+		size_t count = Rev2NrpnTemplates::forChannel(channel()).appendLayer(rawMidi, patch.data(), sourceLayer, targetLayer);
+		metrics_->countGeneratedNRPNs(count);
+		return rawMidi;
+	}
+
 	void Rev2::changeInputChannel(MidiController *controller, MidiChannel newChannel, std::function<void()> onFinished)
 	{
 		ignoreUnused(controller);
 		// The Rev2 will change its channel with a nice NRPN message
 		// See page 87 of the manual
 		// Setting it to 0 would be Omni, so we use one based int
-		sendBlockOfMessagesToSynth(midiOutput(), createNRPN(4098, newChannel.toOneBasedInt()));
+		sendToSynth(createNRPN(4098, newChannel.toOneBasedInt()));
 		setCurrentChannelZeroBased(midiInput(), midiOutput(), newChannel.toZeroBasedInt());
 		onFinished();
 	}
@@ -370,7 +595,7 @@ namespace midikraft {
 	{
 		ignoreUnused(controller);
 		// See page 87 of the manual
-		sendBlockOfMessagesToSynth(midiOutput(), createNRPN(4103, isOn ? 1 : 0));
+		sendToSynth(createNRPN(4103, isOn ? 1 : 0));
 		localControl_ = isOn;
 	}
 
@@ -429,19 +654,24 @@ namespace midikraft {
 
 	bool Rev2::isStreamComplete(std::vector<MidiMessage> const &messages, DataStreamType streamType) const
 	{
+		Rev2TraceSpan span("isStreamComplete", (int64) messages.size());
 		int count = 0;
 		for (auto message : messages) {
 			if (isPartOfDataFileStream(message, streamType)) count++;
 		}
+		bool complete = false;
 		switch (streamType.asInt())
 		{
 		case PATCH_STREAM:
-			if (count == numberOfPatches()) return true;
+			complete = count == numberOfPatches();
 			break;
 		default:
-			if (count >= 1) return true;
+			complete = count >= 1;
 		}
-		return false;
+		if (complete) {
+			Rev2Trace::instance().recordInstant("streamComplete", "rev2", streamType.asInt());
+		}
+		return complete;
 	}
 
 	bool Rev2::isPartOfDataFileStream(const MidiMessage &message, DataStreamType dataTypeID) const
@@ -456,18 +686,6 @@ namespace midikraft {
 		}
 	}
 
-	class Rev2GlobalSettingsDataFile : public DataFile {
-	public:
-		using DataFile::DataFile;
-
-		virtual std::string name() const override;
-	};
-
-	std::string Rev2GlobalSettingsDataFile::name() const
-	{
-		return "Rev2 Global Settings";
-	}
-
 	struct Rev2GlobalSettings {
 		std::vector<DSIGlobalSettingDefinition> definitions = {
 			{ 0, 4097, { "Master Coarse Tune", "Tuning", 12, -12, 12 }, -12 }, // Default 12, displayed as 0
@@ -500,12 +718,10 @@ namespace midikraft {
 			{ 27, 4126, { "Save Edit B Enabled", "Controls", true } },
 		};
 	};
-	std::shared_ptr<Rev2GlobalSettings> sRev2GlobalSettings;
-	std::vector<DSIGlobalSettingDefinition> &gRev2GlobalSettings() {
-		if (!sRev2GlobalSettings) {
-			sRev2GlobalSettings = std::make_shared<Rev2GlobalSettings>();
-		}
-		return sRev2GlobalSettings->definitions;
+	std::vector<DSIGlobalSettingDefinition> const &gRev2GlobalSettings() {
+		// Function local statics are initialized exactly once, even when several Rev2 are created from different threads
+		static Rev2GlobalSettings sRev2GlobalSettings;
+		return sRev2GlobalSettings.definitions;
 	}
 
 	void Rev2::initGlobalSettings()
@@ -524,13 +740,24 @@ namespace midikraft {
 
 	std::vector<std::shared_ptr<DataFile>> Rev2::loadData(std::vector<MidiMessage> messages, DataStreamType dataTypeID) const
 	{
+		Rev2TraceSpan span("loadData", (int64) messages.size());
 		std::vector<std::shared_ptr<DataFile>> result;
+		size_t patches = 0;
+		size_t outOfRange = 0;
 		for (auto m : messages) {
 			if (isPartOfDataFileStream(m, dataTypeID)) {
 				switch (dataTypeID.asInt()) {
-				case PATCH_STREAM:
-					result.push_back(patchFromSysex(m));
+				case PATCH_STREAM: {
+					bool inRange = true;
+					auto patch = decodeDump(m, inRange);
+					if (patch) {
+						patches++;
+						if (!inRange) outOfRange++;
+						programCache_->store(getProgramNumber(m), patch->data());
+						result.push_back(patch);
+					}
 					break;
+				}
 				case GLOBAL_SETTINGS: {
 					std::vector<uint8> syx(m.getSysExData(), m.getSysExData() + m.getSysExDataSize());
 					auto storage = std::make_shared<Rev2GlobalSettingsDataFile>(GLOBAL_SETTINGS, syx);
@@ -554,6 +781,7 @@ namespace midikraft {
 				}
 			}
 		}
+		logOutOfRangePatches(outOfRange, patches);
 		return result;
 	}
 
@@ -600,21 +828,32 @@ namespace midikraft {
 	void Rev2::setLocalControl(MidiController *controller, bool localControlOn)
 	{
 		ignoreUnused(controller);
-		sendBlockOfMessagesToSynth(midiOutput(), createNRPN(4107, localControlOn ? 1 : 0));
+		sendToSynth(createNRPN(4107, localControlOn ? 1 : 0));
 		localControl_ = localControlOn;
 	}
 
 	std::shared_ptr<DataFile> Rev2::patchFromProgramDumpSysex(const MidiMessage& message) const
 	{
-		return patchFromSysex(message);
+		auto patch = patchFromSysex(message);
+		if (patch && isSingleProgramDump(message)) {
+			programCache_->store(getProgramNumber(message), patch->data());
+		}
+		return patch;
 	}
 
 	std::vector<juce::MidiMessage> Rev2::patchToProgramDumpSysex(std::shared_ptr<DataFile> patch, MidiProgramNumber programNumber) const
 	{
+		// We can't know if the synth will accept the program, so better forget what we knew about this place
+		programCache_->invalidate(programNumber);
+
 		// Create a program data dump message
 		int programPlace = programNumber.toZeroBased();
 		std::vector<uint8> programDataDump({ 0x01 /* DSI */, midiModelID_, 0x02 /* Program Data */, (uint8) (programPlace / 128), (uint8) (programPlace % 128) });
-		auto patchData = escapeSysex(patch->data(), 2046);
+		std::vector<uint8> patchData;
+		{
+			Rev2Metrics::ScopedTimer timer(metrics_->encodeTime());
+			patchData = escapeSysex(patch->data(), 2046);
+		}
 		jassert(patchData.size() == 2339);
 		std::copy(patchData.begin(), patchData.end(), std::back_inserter(programDataDump));
 		return std::vector<MidiMessage>({ MidiHelpers::sysexMessage(programDataDump) });
@@ -661,11 +900,154 @@ namespace midikraft {
 
 	std::string Rev2::friendlyProgramName(MidiProgramNumber programNo) const
 	{
-		// The Rev2 has 8 banks of 128 patches, in two sections U and F called U1 to U4 and F1 to F4
-		int bank = programNo.toZeroBased() / 128;
-		int section = bank / 4;
-		int program = programNo.toZeroBased() % 128;
-		return (boost::format("%s%d P%d") % (section == 0 ? "U" : "F") % ((bank % 4) + 1) % program).str();
+		// The Rev2 has 8 banks of 128 patches, in two sections U and F called U1 to U4 and F1 to F4.
+		// The names are short enough to fit into the string's own buffer, so returning a copy doesn't allocate
+		static const std::array<std::string, 1024> kProgramNames = []() {
+			std::array<std::string, 1024> result;
+			for (int place = 0; place < 1024; place++) {
+				int bank = place / 128;
+				int section = bank / 4;
+				int program = place % 128;
+				result[place] = (boost::format("%s%d P%d") % (section == 0 ? "U" : "F") % ((bank % 4) + 1) % program).str();
+			}
+			return result;
+		}();
+		int place = programNo.toZeroBased();
+		if (place < 0 || place >= (int)kProgramNames.size()) {
+			jassertfalse;
+			return (boost::format("Program %d") % place).str();
+		}
+		return kProgramNames[place];
+	}
+
+	std::shared_ptr<Synth::PatchData const> Rev2::initPatchData()
+	{
+		// The resource is a program dump: F0, 5 header bytes, the escaped program data, F7
+		static std::shared_ptr<Synth::PatchData const> sInitPatch = std::make_shared<Synth::PatchData>(
+			unescapeSysex(&Rev2_InitPatch_syx[6], (int) Rev2_InitPatch_syx_size - 7, 2048));
+		return sInitPatch;
+	}
+
+	std::shared_ptr<Rev2ProgramCache> Rev2::programCache() const
+	{
+		return programCache_;
+	}
+
+	std::shared_ptr<Rev2Metrics> Rev2::metrics() const
+	{
+		return metrics_;
+	}
+
+	void Rev2::messageTransferred(MidiMessage const &message, bool outgoing)
+	{
+		Rev2Metrics::MessageType type = Rev2Metrics::OTHER;
+		size_t sysexBytes = 0;
+		if (message.isSysEx()) {
+			sysexBytes = (size_t) message.getSysExDataSize();
+			auto data = message.getSysExData();
+			if (isOwnSysex(message) && sysexBytes > 2) {
+				switch (data[2]) {
+				case 0x02: // Program Data
+					type = Rev2Metrics::PROGRAM_DUMP;
+					if (!outgoing && sysexBytes > 4) metrics_->programReceived(data[3] * 128 + data[4]);
+					break;
+				case 0x05: // Request Program Dump
+					type = Rev2Metrics::PROGRAM_DUMP;
+					if (outgoing && sysexBytes > 4) metrics_->programRequested(data[3] * 128 + data[4]);
+					break;
+				case 0x03: // Edit Buffer Data
+					type = Rev2Metrics::EDIT_BUFFER;
+					if (!outgoing) metrics_->editBufferReceived();
+					break;
+				case 0x06: // Request Edit Buffer Dump
+					type = Rev2Metrics::EDIT_BUFFER;
+					if (outgoing) metrics_->editBufferRequested();
+					break;
+				case 0x0e: // Request Global Parameter Transmit
+				case 0x0f: // Main Parameter Data
+					type = Rev2Metrics::GLOBAL_SETTINGS;
+					break;
+				default:
+					break;
+				}
+			}
+			else if (sysexBytes > 2 && (data[0] == 0x7e || data[0] == 0x7f) && data[2] == 0x08) {
+				// MIDI Tuning Standard, requests and dumps
+				type = Rev2Metrics::TUNING;
+			}
+		}
+		else if (message.isController()) {
+			switch (message.getControllerNumber()) {
+			case 99:
+				// Every NRPN starts with the parameter number MSB, the other three controllers belong to it
+				type = Rev2Metrics::NRPN;
+				break;
+			case 98:
+			case 6:
+			case 38:
+				return;
+			default:
+				break;
+			}
+		}
+		if (outgoing) {
+			metrics_->countOutgoing(type, sysexBytes);
+		}
+		else {
+			metrics_->countIncoming(type, sysexBytes);
+		}
+	}
+
+	std::vector<juce::MidiMessage> Rev2::createNRPN(int parameterNo, int value)
+	{
+		metrics_->countGeneratedNRPNs(1);
+		// Keep track of the settings that decide how we can talk to the synth
+		if (parameterNo == kParamReceiveNRPN) {
+			paramReceiveMode_ = value;
+		}
+		else if (parameterNo == kSelectLayerNRPN) {
+			selectedLayer_ = value;
+		}
+		return DSISynth::createNRPN(parameterNo, value);
+	}
+
+	Rev2::ParamReceiveMode Rev2::paramReceiveMode() const
+	{
+		return ParamReceiveMode(paramReceiveMode_.load());
+	}
+
+	void Rev2::setParamReceiveMode(ParamReceiveMode mode)
+	{
+		paramReceiveMode_ = (int) mode;
+	}
+
+	int Rev2::selectedLayer() const
+	{
+		return selectedLayer_;
+	}
+
+	std::vector<MidiMessage> Rev2::parameterChangeMessages(int nrpn, int value) const
+	{
+		int layer = nrpn >= kNRPNStartLayerB ? 1 : 0;
+		int controller = Rev2ParamLayout::controllerForNRPN(nrpn % kNRPNStartLayerB);
+		if (controller != -1 && value >= 0 && value <= 127 && paramReceiveMode() == ParamReceiveMode::CC && selectedLayer() == layer) {
+			return { MidiMessage::controllerEvent(channel().toOneBasedInt(), controller, value) };
+		}
+		metrics_->countGeneratedNRPNs(1);
+		return MidiHelpers::generateRPN(channel().toOneBasedInt(), nrpn, value, true, true, true);
+	}
+
+	void Rev2::setGlobalSettingsFromDataFile(std::shared_ptr<DataFile> dataFile)
+	{
+		DSISynth::setGlobalSettingsFromDataFile(dataFile);
+		if (dataFile && dataFile->dataTypeID() == settingsDataFileType()) {
+			// The stored global settings are the sysex without F0 and F7, the parameters start after the 3 header bytes
+			for (auto const &setting : gRev2GlobalSettings()) {
+				if (setting.nrpn == kParamReceiveNRPN && 3 + setting.sysexIndex < (int) dataFile->data().size()) {
+					paramReceiveMode_ = dataFile->data()[3 + setting.sysexIndex];
+				}
+			}
+		}
 	}
 
 	bool Rev2::shouldStreamAdvance(std::vector<MidiMessage> const &messages, DataStreamType streamType) const
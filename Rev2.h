@@ -13,6 +13,10 @@
 #include "DataFileLoadCapability.h"
 #include "DataFileSendCapability.h"
 
+#include "Rev2ProgramCache.h"
+#include "Rev2Metrics.h"
+#include "Rev2Bank.h"
+
 namespace midikraft {
 
 	class Rev2 : public DSISynth, public LayerCapability, public DataFileLoadCapability, public DataFileSendCapability, public std::enable_shared_from_this<Rev2>
@@ -33,6 +37,20 @@ namespace midikraft {
 		// Basic Synth
 		virtual std::string getName() const override;
 		virtual std::shared_ptr<DataFile> patchFromPatchData(const Synth::PatchData &data, MidiProgramNumber place) const override;
+		// Batch version for opening whole libraries, places must have the same size as data
+		std::vector<std::shared_ptr<DataFile>> patchesFromPatchData(std::vector<Synth::PatchData> const &data, std::vector<MidiProgramNumber> const &places) const;
+		// Determine the data type of stored data directly from the bytes. Stored data files are sysex without the F0 and F7 bytes,
+		// except for patches, which are stored decoded
+		DataFileType classifyPatchData(const uint8 *data, size_t size) const;
+		// FNV-1a hash over the same bytes filterVoiceRelevantData() keeps, without copying the patch. Equal for a patch and its read-back from the synth
+		static uint64 voiceFingerprint(const uint8 *data, size_t size);
+		static uint64 voiceFingerprint(Synth::PatchData const &data);
+		// FNV-1a hash over everything a program dump writes, including the layer names. Only the two bytes hit by the firmware
+		// encoding bug are left out, so this too is equal for a patch and its read-back
+		static uint64 contentFingerprint(const uint8 *data, size_t size);
+		static uint64 contentFingerprint(Synth::PatchData const &data);
+		// Decodes all program and edit buffer dumps into one contiguous bank, instead of one Rev2Patch per program like loadData()
+		Rev2Bank loadBank(std::vector<MidiMessage> const &messages) const;
 		virtual int numberOfBanks() const override;
 		virtual int numberOfPatches() const override;
 		virtual std::string friendlyProgramName(MidiProgramNumber programNo) const override;
@@ -50,9 +68,24 @@ namespace midikraft {
 		MidiMessage clearPolySequencer(const MidiMessage &programEditBuffer, bool layerA, bool layerB);
 		MidiMessage copySequencersFromOther(const MidiMessage& currentProgram, const MidiMessage &lockedProgram);
 
+		// Fast path for the sequence lock - the sequencer bytes of the locked program are pre-split into the escaped 8 byte groups
+		// (1 msb byte + 7 data bytes) they occupy, so they can be spliced into an incoming edit buffer without decoding it
+		struct SequencerSplice {
+			struct Group {
+				size_t groupIndex;
+				uint8 mask; // Bit i set means data byte i of this group is taken from the locked program
+				uint8 bytes[8];
+			};
+			std::vector<Group> groups;
+		};
+		SequencerSplice prepareSequencerSplice(const MidiMessage &lockedProgram) const;
+		MidiMessage spliceSequencers(const MidiMessage &currentProgram, SequencerSplice const &splice) const;
+
 		// LayerCapability
 		virtual void switchToLayer(int layerNo) override;
 		virtual std::vector<MidiMessage> layerToSysex(std::shared_ptr<DataFile> const patch, int sourceLayer, int targetLayer) const override;
+		// Same NRPNs as layerToSysex, as one raw MIDI buffer filled from precomputed templates. Send it with sendRawToSynth()
+		std::vector<uint8> layerToRawNRPN(DataFile const &patch, int sourceLayer, int targetLayer) const;
 
 		// SoundExpanderCapability
 		virtual void changeInputChannel(MidiController *controller, MidiChannel channel, std::function<void()> onFinished) override;
@@ -90,12 +123,52 @@ namespace midikraft {
 		// Implement generic DSISynth global settings capability
 		virtual std::vector<DSIGlobalSettingDefinition> dsiGlobalSettings() const override;
 
+		// The decoded init patch, shared by all new patches
+		static std::shared_ptr<Synth::PatchData const> initPatchData();
+
+		// Program dumps seen so far, to answer "which patch is the synth playing" without a round trip
+		std::shared_ptr<Rev2ProgramCache> programCache() const;
+
+		// Traffic counters and timings, for the host application to poll. Traffic is counted on the messages that pass
+		// sendBlockOfMessagesToSynth() (which sendToSynth() uses), sendRawToSynth() and recordIncoming(), so only what was really
+		// sent to or received from the synth
+		std::shared_ptr<Rev2Metrics> metrics() const;
+
+		// Live editing transport. When "MIDI Param Receive" is set to CC, the parameters with a CC equivalent are sent as one 3 byte 
+		// controller message instead of a 12 byte NRPN, if the value fits and the parameter is for the layer selected on the synth
+		enum class ParamReceiveMode {
+			OFF = 0,
+			CC = 1,
+			NRPN = 2
+		};
+		ParamReceiveMode paramReceiveMode() const;
+		// Use this if the setting is known from elsewhere, changes via the global settings are tracked automatically
+		void setParamReceiveMode(ParamReceiveMode mode);
+		// The layer last selected with switchToLayer(), -1 if unknown
+		int selectedLayer() const;
+		// nrpn includes the layer B offset
+		std::vector<MidiMessage> parameterChangeMessages(int nrpn, int value) const;
+
+		virtual void setGlobalSettingsFromDataFile(std::shared_ptr<DataFile> dataFile) override;
+
+	protected:
+		virtual std::vector<MidiMessage> createNRPN(int parameterNo, int value) override;
+		// Counts the traffic metrics, on the messages really sent and received
+		virtual void messageTransferred(MidiMessage const &message, bool outgoing) override;
+
 	private:
+		// patchFromSysex() without the warning, so bulk loads can report out of range values once
+		std::shared_ptr<DataFile> decodeDump(const MidiMessage& message, bool &inRange) const;
 		MidiMessage buildSysexFromEditBuffer(std::vector<uint8> editBuffer);
 		MidiMessage filterProgramEditBuffer(const MidiMessage &programEditBuffer, std::function<void(std::vector<uint8> &)> filterExpressionInPlace);
 
 		void initGlobalSettings();
 
+		std::shared_ptr<Rev2ProgramCache> programCache_;
+		std::shared_ptr<Rev2Metrics> metrics_;
+		std::atomic<int> paramReceiveMode_;
+		std::atomic<int> selectedLayer_;
+
 		// That's not very Rev2 specific
 		static uint8 clamp(int value, uint8 min = 0, uint8 max = 127);
 	};
@@ -1,209 +1,333 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
 #include "Rev2BCR2000.h"
 
-#include "NrpnDefinition.h"
 #include "Rev2.h"
+#include "Rev2ParamLayout.h"
 
 #include "BCR2000.h"
-#include "NRPNBCRDefinition.h"
 
-#include <vector>
+#include <algorithm>
 #include <numeric>
+#include <set>
+#include <sstream>
 #include <boost/format.hpp>
 
-// Trying to squeeze everything into a single BCR2000 preset, for Layer A
-std::vector<Rev2BCR2000Definition *> singlePageControllerSetup =
-{
-	new Rev2BCR2000Definition(ENCODER, 1, 192),
-	new Rev2BCR2000Definition(ENCODER, 9, 208),
-	new Rev2BCR2000Definition(ENCODER, 17, 224),
-	new Rev2BCR2000Definition(ENCODER, 25, 240),
-	new Rev2BCR2000RestDefinition(33, 192),
-	new Rev2BCR2000RestDefinition(41, 200),
-	new Rev2BCR2000Definition(ENCODER, 33, 200),
-	new Rev2BCR2000Definition(ENCODER, 41, 216),
-	new Rev2BCR2000Definition(ENCODER, 49, 232),
-	// new Rev2BCR2000Definition(ENCODER, 57, 248), // Darn, the BCR2000 does not have enough controllers! I need 8 more!
-};
-
-// Setup definition of BCR2000 for the Rev2 Gated Step Sequencers.
-// 8 Pages for the 8 tracks
-std::vector<std::vector<Rev2BCR2000Definition *>> basisControllerSetup = {
-	{
-		new Rev2BCR2000Definition(ENCODER, 1, 184, false), // Track 1 Destination
-		new Rev2BCR2000Definition(ENCODER, 8, 182, false, CUT), // Gated Sequencer Mode
-		new Rev2BCR2000Definition(BUTTON, 8, 183, false), // Gated Sequencer On/Off
-		new Rev2BCR2000Definition(ENCODER, 33, 192), // Layer A Track 1
-		new Rev2BCR2000Definition(ENCODER, 41, 200),
-		new Rev2BCR2000RestDefinition(33, 192), // Rest Buttons
-		new Rev2BCR2000RestDefinition(41, 200),
-	},
-	{
-		new Rev2BCR2000Definition(ENCODER, 1, 185, false), // Track 2 Destination
-		new Rev2BCR2000Definition(ENCODER, 8, 182, false, CUT), // Gated Sequencer Mode
-		new Rev2BCR2000Definition(BUTTON, 8, 183, false), // Gated Sequencer On/Off
-		new Rev2BCR2000Definition(ENCODER, 33, 208), // Layer A Track 2
-		new Rev2BCR2000Definition(ENCODER, 41, 216),
-	},
-	{
-		new Rev2BCR2000Definition(ENCODER, 1, 186, false), // Track 3 Destination
-		new Rev2BCR2000Definition(ENCODER, 8, 182, false, CUT), // Gated Sequencer Mode
-		new Rev2BCR2000Definition(BUTTON, 8, 183, false), // Gated Sequencer On/Off
-		new Rev2BCR2000Definition(ENCODER, 33, 224), // Layer A Track 3
-		new Rev2BCR2000Definition(ENCODER, 41, 232),
-	},
+namespace midikraft {
+
+	// Trying to squeeze everything into a single BCR2000 preset, for Layer A
+	const std::vector<Rev2BCR2000Control> singlePageControllerSetup =
 	{
-		new Rev2BCR2000Definition(ENCODER, 1, 187, false), // Track 4 Destination
-		new Rev2BCR2000Definition(ENCODER, 8, 182, false, CUT), // Gated Sequencer Mode
-		new Rev2BCR2000Definition(BUTTON, 8, 183, false), // Gated Sequencer On/Off
-		new Rev2BCR2000Definition(ENCODER, 33, 240), // Layer A Track 4
-		new Rev2BCR2000Definition(ENCODER, 41, 248),
-	},
-};
-
-Rev2BCR2000Definition * Rev2BCR2000Definition::cloneWithOffset(int offset, int additionalNRPNOffset)
-{
-	return new Rev2BCR2000Definition(type_, number_ + offset, nrpn_ + offset + additionalNRPNOffset);
-}
+		{ ENCODER, 1, 192, true, ONE_DOT_OFF, false },
+		{ ENCODER, 9, 208, true, ONE_DOT_OFF, false },
+		{ ENCODER, 17, 224, true, ONE_DOT_OFF, false },
+		{ ENCODER, 25, 240, true, ONE_DOT_OFF, false },
+		{ BUTTON, 33, 192, true, ONE_DOT_OFF, true },
+		{ BUTTON, 41, 200, true, ONE_DOT_OFF, true },
+		{ ENCODER, 33, 200, true, ONE_DOT_OFF, false },
+		{ ENCODER, 41, 216, true, ONE_DOT_OFF, false },
+		{ ENCODER, 49, 232, true, ONE_DOT_OFF, false },
+		// { ENCODER, 57, 248 }, // Darn, the BCR2000 does not have enough controllers! I need 8 more!
+	};
 
-std::string generateBCR_Custom(NRPNBCRdefinition const &def, int channel) 
-{
-	int code = 0xB0 | channel;
-	std::string nrpnString = (boost::format("$%0x $63 $%0x $%0x $62 $%0x $%0x $06 $00 $%0x $26 val")
-		% code % (def.nrpnNumber_ >> 7)
-		% code % (def.nrpnNumber_ & 0x7f)
-		% code
-		% code
-		).str();
-
-	int fakeChannel = 16;
-	switch (def.type()) {
-	case ENCODER: {
-		// Super special case for the gated sequencer - if the maxValue is 127, limit it to 126
-		// The 127 can only be set with the rest button
-		int gatedMaxValue = def.maxValue_ == 127 ? 126 : def.maxValue_;
-		return (boost::format(
-			"$encoder %d ; %s\n"
-			"  .easypar NRPN %d %d 1 0 absolute\n"
-			"  .tx %s\n"
-			"  .minmax %d %d\n"
-			"  .default %d\n"
-			"  .mode %s\n"
-			"  .showvalue on\n"
-			"  .resolution 64 92 127 127\n"
-		) % def.encoderNumber() % def.description_ % fakeChannel % def.nrpnNumber_ % nrpnString % def.minValue_ % gatedMaxValue % def.defaultValue_ % def.ledMode_).str();
-	}
-	case BUTTON:
-		return (boost::format(
-			"$button %d ; %s\n"
-			"  .easypar NRPN %d %d %d %d toggleon\n"
-			"  .tx %s\n"
-			"  .default %s\n"
-			"  .showvalue on\n"
-		) % def.encoderNumber() % def.description_ % (channel + 1) % def.nrpnNumber_ %  def.maxValue_ % def.minValue_% nrpnString % def.defaultValue_).str(); // Note the flipped min and max for buttons!!!
-	default:
-		assert(false);
-		return (boost::format(
-			"; %s\n"
-		) % def.description_).str();
-	}
-}
+	// Setup definition of BCR2000 for the Rev2 Gated Step Sequencers.
+	// 8 Pages for the 8 tracks
+	const std::vector<std::vector<Rev2BCR2000Control>> basisControllerSetup = {
+		{
+			{ ENCODER, 1, 184, false, ONE_DOT_OFF, false }, // Track 1 Destination
+			{ ENCODER, 8, 182, false, CUT, false }, // Gated Sequencer Mode
+			{ BUTTON, 8, 183, false, ONE_DOT_OFF, false }, // Gated Sequencer On/Off
+			{ ENCODER, 33, 192, true, ONE_DOT_OFF, false }, // Layer A Track 1
+			{ ENCODER, 41, 200, true, ONE_DOT_OFF, false },
+			{ BUTTON, 33, 192, true, ONE_DOT_OFF, true }, // Rest Buttons
+			{ BUTTON, 41, 200, true, ONE_DOT_OFF, true },
+		},
+		{
+			{ ENCODER, 1, 185, false, ONE_DOT_OFF, false }, // Track 2 Destination
+			{ ENCODER, 8, 182, false, CUT, false }, // Gated Sequencer Mode
+			{ BUTTON, 8, 183, false, ONE_DOT_OFF, false }, // Gated Sequencer On/Off
+			{ ENCODER, 33, 208, true, ONE_DOT_OFF, false }, // Layer A Track 2
+			{ ENCODER, 41, 216, true, ONE_DOT_OFF, false },
+		},
+		{
+			{ ENCODER, 1, 186, false, ONE_DOT_OFF, false }, // Track 3 Destination
+			{ ENCODER, 8, 182, false, CUT, false }, // Gated Sequencer Mode
+			{ BUTTON, 8, 183, false, ONE_DOT_OFF, false }, // Gated Sequencer On/Off
+			{ ENCODER, 33, 224, true, ONE_DOT_OFF, false }, // Layer A Track 3
+			{ ENCODER, 41, 232, true, ONE_DOT_OFF, false },
+		},
+		{
+			{ ENCODER, 1, 187, false, ONE_DOT_OFF, false }, // Track 4 Destination
+			{ ENCODER, 8, 182, false, CUT, false }, // Gated Sequencer Mode
+			{ BUTTON, 8, 183, false, ONE_DOT_OFF, false }, // Gated Sequencer On/Off
+			{ ENCODER, 33, 240, true, ONE_DOT_OFF, false }, // Layer A Track 4
+			{ ENCODER, 41, 248, true, ONE_DOT_OFF, false },
+		},
+	};
 
+	const int kFakeChannel = 16;
 
-std::string Rev2BCR2000Definition::generateBCR(int channel) const
-{
-	// Get the full definition
-	auto nrpn = Rev2::nrpn(nrpn_);
+	static void writeHex(std::ostream &out, int value)
+	{
+		static const char kHexDigits[] = "0123456789abcdef";
+		out << '$';
+		if (value >= 16) out << kHexDigits[(value >> 4) & 0x0f];
+		out << kHexDigits[value & 0x0f];
+	}
 
-	// This works because all parameters in the Rev2 can be set via NRPN numbers.
-	auto name = nrpn.name();
-	NRPNBCRdefinition def(name, type_, number_, nrpn_, nrpn.min(), nrpn.max(), 0, BCRdefinition::ledMode(ledMode_));
-	return generateBCR_Custom(def, channel);
-}
+	static void writeNRPNSequence(std::ostream &out, int code, int nrpn)
+	{
+		writeHex(out, code); out << " $63 "; writeHex(out, nrpn >> 7); out << ' ';
+		writeHex(out, code); out << " $62 "; writeHex(out, nrpn & 0x7f); out << ' ';
+		writeHex(out, code); out << " $06 $00 ";
+		writeHex(out, code); out << " $26 ";
+	}
 
-std::vector<Rev2BCR2000Definition *> Rev2BCR2000::explodeBy8(std::vector<Rev2BCR2000Definition *> const &controllerSetup, int nrpnOffset) {
-	std::vector<Rev2BCR2000Definition *> result;
-	for (auto def : controllerSetup) {
-		if (def->canBeCloned()) {
-			for (int i = 0; i < 8; i++) {
-				result.push_back(def->cloneWithOffset(i, nrpnOffset));
-			}
+	static void writeName(std::ostream &out, int nrpn)
+	{
+		// This works because all parameters in the Rev2 can be set via NRPN numbers.
+		auto descriptor = Rev2ParamLayout::findByNRPN(nrpn);
+		if (!descriptor) {
+			jassertfalse;
+			out << "NRPN " << nrpn;
+			return;
 		}
-		else {
-			// Just take it once as is
-			result.push_back(def->cloneWithOffset(0, nrpnOffset));
+		out << descriptor->name;
+		if (descriptor->isArray()) {
+			out << " Step " << (nrpn % kNRPNStartLayerB - descriptor->nrpn + 1);
 		}
 	}
-	return result;
-}
 
-std::string Rev2BCR2000::generateBCR(Rev2 &rev2, int baseStoragePlace, bool includeHeaderAndFooter)
-{
-	std::string result;
-	if (includeHeaderAndFooter) result = BCR2000::generateBCRHeader();
-	assert(baseStoragePlace != -1); // That won't work anymore
-	result += generateMapping(rev2.presetName(), rev2.channel().toZeroBasedInt(), baseStoragePlace, 0);
-	result += generateMapping(rev2.presetName() + " Layer B", rev2.channel().toZeroBasedInt(), baseStoragePlace + 4, 2048);
-	if (includeHeaderAndFooter) result += BCR2000::generateBCREnd(baseStoragePlace);
-	return result;
-}
-
-std::string Rev2BCR2000::generateMapping(std::string const &presetName, int channel, int storagePlace, int additionalNRPNOffset) {
-	std::string result;
+	void Rev2BCR2000::writeControl(std::ostream &out, Rev2BCR2000Control const &control, int channel)
+	{
+		auto descriptor = Rev2ParamLayout::findByNRPN(control.nrpn);
+		int minValue = descriptor ? descriptor->minValue : 0;
+		int maxValue = descriptor ? descriptor->maxValue : 127;
+		int code = 0xB0 | channel;
 
-	// We're generating a bunch of presets for the BCR2000 now
-	for (int presetNum = 0; presetNum < basisControllerSetup.size(); presetNum++) {
-		// Postfix the given name with the number
-		std::string detailedName = presetName;
-		if (presetNum > 0) {
-			detailedName = (boost::format("%s %d") % presetName % presetNum).str();
+		if (control.isRest) {
+			int nrpnSequence[] = { code, 0x63, control.nrpn >> 7, code, 0x62, (control.nrpn & 0x7f), code, 0x06, 0x00, code, 0x26 };
+			int magicNumber = (0x00 - 0xf7 - std::accumulate(std::begin(nrpnSequence), std::end(nrpnSequence), 0)) & 0x7f;
+			out << "$button " << control.number << " ; "; writeName(out, control.nrpn); out << "\n"
+				<< "  .easypar NRPN " << kFakeChannel << ' ' << control.nrpn << " 1 0 toggleon\n"
+				<< "  .default 1\n"
+				<< "  .mode toggle\n"
+				<< "  .showvalue on\n"
+				<< "  .tx $F0 $7D $7F val cks-2 2 " << magicNumber << " $F7 ";
+			writeNRPNSequence(out, code, control.nrpn);
+			out << "cks-2 4\n";
+			return;
 		}
-		result += BCR2000::generatePresetHeader(detailedName);
 
-		// Loop over all Matrix 1000 Parameters, and write out a proper encoder definition
-		std::vector<std::pair<BCRdefinition *, std::string>> all_entries;
-		std::vector<Rev2BCR2000Definition *> controllerSetup = explodeBy8(basisControllerSetup[presetNum], additionalNRPNOffset);
-		for (auto controller : controllerSetup) {
-			all_entries.push_back(std::make_pair(controller, controller->generateBCR(channel)));
+		switch (control.type) {
+		case ENCODER: {
+			// Super special case for the gated sequencer - if the maxValue is 127, limit it to 126
+			// The 127 can only be set with the rest button
+			int gatedMaxValue = maxValue == 127 ? 126 : maxValue;
+			out << "$encoder " << control.number << " ; "; writeName(out, control.nrpn); out << "\n"
+				<< "  .easypar NRPN " << kFakeChannel << ' ' << control.nrpn << " 1 0 absolute\n"
+				<< "  .tx ";
+			writeNRPNSequence(out, code, control.nrpn);
+			out << "val\n"
+				<< "  .minmax " << minValue << ' ' << gatedMaxValue << "\n"
+				<< "  .default 0\n"
+				<< "  .mode " << BCRdefinition::ledMode(control.ledMode) << "\n"
+				<< "  .showvalue on\n"
+				<< "  .resolution 64 92 127 127\n";
+			break;
 		}
+		case BUTTON:
+			// Note the flipped min and max for buttons!!!
+			out << "$button " << control.number << " ; "; writeName(out, control.nrpn); out << "\n"
+				<< "  .easypar NRPN " << (channel + 1) << ' ' << control.nrpn << ' ' << maxValue << ' ' << minValue << " toggleon\n"
+				<< "  .tx ";
+			writeNRPNSequence(out, code, control.nrpn);
+			out << "val\n"
+				<< "  .default 0\n"
+				<< "  .showvalue on\n";
+			break;
+		default:
+			jassertfalse;
+			out << "; "; writeName(out, control.nrpn); out << "\n";
+		}
+	}
 
-		result += BCR2000::generateAllEncoders(all_entries);
-		result += BCR2000::generateBCRFooter(storagePlace != -1 ? storagePlace + presetNum : -1);
-
+	void Rev2BCR2000::explodeBy8(std::vector<Rev2BCR2000Control> const &controllerSetup, int nrpnOffset, std::vector<Rev2BCR2000Control> &result) {
+		result.clear();
 		for (auto def : controllerSetup) {
-			delete def;
+			int copies = def.canBeCloned ? 8 : 1;
+			for (int i = 0; i < copies; i++) {
+				Rev2BCR2000Control clone = def;
+				clone.number += i;
+				clone.nrpn += i + nrpnOffset;
+				result.push_back(clone);
+			}
 		}
+		// The BCL lists the encoders first, then the buttons, each in ascending order
+		std::stable_sort(result.begin(), result.end(), [](Rev2BCR2000Control const &a, Rev2BCR2000Control const &b) {
+			return a.type != b.type ? a.type < b.type : a.number < b.number;
+		});
 	}
 
-	return result;
-}
+	std::string Rev2BCR2000::generateBCR(Rev2 &rev2, int baseStoragePlace, bool includeHeaderAndFooter)
+	{
+		std::ostringstream result;
+		writeBCR(result, rev2.getName(), rev2.channel(), baseStoragePlace, includeHeaderAndFooter);
+		return result.str();
+	}
 
-Rev2BCR2000Definition * Rev2BCR2000RestDefinition::cloneWithOffset(int offset, int additionalNRPNOffset)
-{
-	return new Rev2BCR2000RestDefinition(number_ + offset, nrpn_ + offset+ additionalNRPNOffset);
-}
+	void Rev2BCR2000::writeBCR(std::ostream &out, std::string const &presetName, MidiChannel channel, int baseStoragePlace, bool includeHeaderAndFooter)
+	{
+		jassert(baseStoragePlace != -1); // That won't work anymore
+		// One arena for all presets, after the first preset there are no more allocations for the controls
+		std::vector<Rev2BCR2000Control> arena;
+		arena.reserve(64);
+		if (includeHeaderAndFooter) out << BCR2000::generateBCRHeader();
+		writeMapping(out, presetName, channel.toZeroBasedInt(), baseStoragePlace, 0, arena);
+		writeMapping(out, presetName + " Layer B", channel.toZeroBasedInt(), baseStoragePlace + 4, kNRPNStartLayerB, arena);
+		if (includeHeaderAndFooter) out << BCR2000::generateBCREnd(baseStoragePlace);
+	}
+
+	void Rev2BCR2000::writeMapping(std::ostream &out, std::string const &presetName, int channel, int storagePlace, int additionalNRPNOffset, std::vector<Rev2BCR2000Control> &arena) {
+		// We're generating a bunch of presets for the BCR2000 now
+		for (int presetNum = 0; presetNum < (int)basisControllerSetup.size(); presetNum++) {
+			// Postfix the given name with the number
+			if (presetNum > 0) {
+				out << BCR2000::generatePresetHeader(presetName + " " + std::to_string(presetNum));
+			}
+			else {
+				out << BCR2000::generatePresetHeader(presetName);
+			}
 
-std::string Rev2BCR2000RestDefinition::generateBCR(int channel) const
-{
-	// Get the full definition
-	auto nrpn = Rev2::nrpn(nrpn_);
-
-	int code = 0xB0 | channel;
-	std::vector<int> nrpnSequence = { code, 0x63, nrpn_ >> 7, code, 0x62, (nrpn_ & 0x7f), code, 0x06, 0x00, code, 0x26 };
-	int magicNumber = (0x00 - 0xf7 - std::accumulate(nrpnSequence.begin(), nrpnSequence.end(), 0)) & 0x7f;
-	std::string nrpnString;
-	for (auto codeInSequence : nrpnSequence) {
-		nrpnString += (boost::format("$%0x ") % codeInSequence).str();
+			explodeBy8(basisControllerSetup[presetNum], additionalNRPNOffset, arena);
+			for (auto const &controller : arena) {
+				writeControl(out, controller, channel);
+			}
+
+			out << BCR2000::generateBCRFooter(storagePlace != -1 ? storagePlace + presetNum : -1);
+		}
 	}
 
-	int fakeChannel = 16;
-	return (boost::format(
-		"$button %d ; %s\n"
-		"  .easypar NRPN %d %d 1 0 toggleon\n"
-		"  .default 1\n"
-		"  .mode toggle\n"
-		"  .showvalue on\n"
-		"  .tx $F0 $7D $7F val cks-2 2 %d $F7 %scks-2 4\n"
-	) % number_ % nrpn.name()
-		% fakeChannel % nrpn_ % magicNumber % nrpnString).str();
+	static std::string trim(std::string const &text)
+	{
+		auto first = text.find_first_not_of(" \t\r");
+		if (first == std::string::npos) return "";
+		auto last = text.find_last_not_of(" \t\r");
+		return text.substr(first, last - first + 1);
+	}
+
+	std::vector<Rev2BCLPreset> Rev2BCR2000::parseBCL(std::string const &bcl)
+	{
+		std::vector<Rev2BCLPreset> result;
+		Rev2BCLControl *control = nullptr;
+		std::istringstream lines(bcl);
+		std::string line;
+		while (std::getline(lines, line)) {
+			line = trim(line);
+			if (line.empty()) continue;
+			std::istringstream tokens(line);
+			std::string keyword;
+			tokens >> keyword;
+			if (keyword == "$preset") {
+				result.emplace_back();
+				control = nullptr;
+			}
+			else if (result.empty()) {
+				// Header lines like $rev
+				continue;
+			}
+			else if (keyword == "$encoder" || keyword == "$button") {
+				Rev2BCLControl parsed;
+				parsed.type = keyword == "$encoder" ? ENCODER : BUTTON;
+				tokens >> parsed.number;
+				auto comment = line.find(';');
+				if (comment != std::string::npos) {
+					parsed.description = trim(line.substr(comment + 1));
+				}
+				result.back().controls.push_back(parsed);
+				control = &result.back().controls.back();
+			}
+			else if (keyword == "$store") {
+				tokens >> result.back().storagePlace;
+				control = nullptr;
+			}
+			else if (keyword == ".name" && !control) {
+				auto open = line.find('\'');
+				auto close = line.rfind('\'');
+				if (open != std::string::npos && close > open) {
+					result.back().name = trim(line.substr(open + 1, close - open - 1));
+				}
+			}
+			else if (control) {
+				if (keyword == ".easypar") {
+					std::string type;
+					int first, second;
+					tokens >> type >> control->easyparChannel >> control->nrpn >> first >> second;
+					if (control->type == BUTTON) {
+						// Buttons have min and max flipped
+						control->maxValue = first;
+						control->minValue = second;
+					}
+				}
+				else if (keyword == ".minmax") {
+					tokens >> control->minValue >> control->maxValue;
+				}
+				else if (keyword == ".default") {
+					tokens >> control->defaultValue;
+				}
+				else if (keyword == ".mode") {
+					tokens >> control->mode;
+				}
+				else if (keyword == ".tx") {
+					std::string token;
+					while (tokens >> token) {
+						if (token.size() > 1 && token[0] == '$') {
+							control->tx.push_back((int)std::stoul(token.substr(1), nullptr, 16));
+						}
+						else {
+							control->tx.push_back(token == "val" ? Rev2BCLControl::kTxValue : Rev2BCLControl::kTxOther);
+						}
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	std::vector<std::string> Rev2BCR2000::checkPresets(std::vector<Rev2BCLPreset> const &presets, MidiChannel channel)
+	{
+		std::vector<std::string> problems;
+		int code = 0xB0 | channel.toZeroBasedInt();
+		for (auto const &preset : presets) {
+			std::set<std::pair<int, int>> seen;
+			for (auto const &control : preset.controls) {
+				std::string where = (boost::format("Preset '%s' %s %d") % preset.name % (control.type == ENCODER ? "encoder" : "button") % control.number).str();
+				if (!seen.insert({ control.type, control.number }).second) {
+					problems.push_back(where + " is defined twice");
+				}
+				if (control.number < 1 || control.number > (control.type == ENCODER ? 56 : 64)) {
+					problems.push_back(where + " does not exist on the BCR2000");
+				}
+				auto descriptor = Rev2ParamLayout::findByNRPN(control.nrpn);
+				if (!descriptor) {
+					problems.push_back((boost::format("%s sends unknown NRPN %d") % where % control.nrpn).str());
+					continue;
+				}
+				bool isRest = !control.tx.empty() && control.tx[0] == 0xF0;
+				if (!isRest && (control.minValue < descriptor->minValue || control.maxValue > descriptor->maxValue)) {
+					problems.push_back((boost::format("%s range %d-%d exceeds %s range %d-%d") % where % control.minValue % control.maxValue % descriptor->name % descriptor->minValue % descriptor->maxValue).str());
+				}
+				std::vector<int> expected = { code, 0x63, control.nrpn >> 7, code, 0x62, control.nrpn & 0x7f, code, 0x06, 0x00, code, 0x26 };
+				if (std::search(control.tx.begin(), control.tx.end(), expected.begin(), expected.end()) == control.tx.end()) {
+					problems.push_back((boost::format("%s does not transmit NRPN %d on channel %d") % where % control.nrpn % channel.toOneBasedInt()).str());
+				}
+			}
+		}
+		return problems;
+	}
 
 }
@@ -1,44 +1,77 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
 #pragma once
 
 #include "BCRDefinition.h"
 
-class Rev2;
+#include "MidiChannel.h"
 
+#include <ostream>
 #include <vector>
 
-class Rev2BCR2000Definition : public BCRStandardDefinition {
-public:
-	Rev2BCR2000Definition(BCRtype type, int number, int nrpn, bool canBeCloned = true, BCRledMode ledMode = ONE_DOT_OFF) : 
-		BCRStandardDefinition(type, number), nrpn_(nrpn), canBeCloned_(canBeCloned), ledMode_(ledMode) {}
+namespace midikraft {
+
+	class Rev2;
+
+	// One encoder or button of the BCR2000 sending a Rev2 NRPN. These are plain values, so all controls of a preset
+	// are exploded into a single vector instead of being allocated one by one
+	struct Rev2BCR2000Control {
+		BCRtype type;
+		int number;
+		int nrpn;
+		bool canBeCloned;
+		BCRledMode ledMode;
+		// This is the super special case of the REST buttons for the Gated Sequencer
+		// in order for the lamp to show "active" = 0, we need to invert the value
+		bool isRest;
+	};
 
-	virtual Rev2BCR2000Definition *cloneWithOffset(int offset, int additionalNRPNOffset);
-	virtual std::string generateBCR(int channel) const;
+	// A control as read back from a BCL file
+	struct Rev2BCLControl {
+		BCRtype type;
+		int number;
+		std::string description;
+		int easyparChannel = -1;
+		int nrpn = -1;
+		int minValue = 0;
+		int maxValue = 0;
+		int defaultValue = 0;
+		std::string mode;
+		// The bytes of the .tx line, kTxValue marks the position of the value, kTxOther any other keyword
+		std::vector<int> tx;
 
-	bool canBeCloned() const { return canBeCloned_;  }
+		static constexpr int kTxValue = -1;
+		static constexpr int kTxOther = -2;
+	};
 
-protected: 
-	int nrpn_;
-	bool canBeCloned_;
-	BCRledMode ledMode_;
-};
+	struct Rev2BCLPreset {
+		std::string name;
+		int storagePlace = -1;
+		std::vector<Rev2BCLControl> controls;
+	};
 
-class Rev2BCR2000RestDefinition : public Rev2BCR2000Definition {
-public:
-	Rev2BCR2000RestDefinition(int number, int nrpn) : Rev2BCR2000Definition(BUTTON, number, nrpn) {}
+	class Rev2BCR2000 {
+	public:
+		static std::string generateBCR(Rev2 &rev2, int baseStoragePlace, bool includeHeaderAndFooter = true);
 
-	virtual Rev2BCR2000Definition *cloneWithOffset(int offset, int additionalNRPNOffset) override;
+		// Writes the presets for layer A and layer B of the given channel directly to the stream.
+		// Layer A is stored at baseStoragePlace, layer B 4 presets later
+		static void writeBCR(std::ostream &out, std::string const &presetName, MidiChannel channel, int baseStoragePlace, bool includeHeaderAndFooter = true);
 
-	// This is the super special case of the REST buttons for the Gated Sequencer
-	// in order for the lamp to show "active" = 0, we need to invert the value
-	virtual std::string generateBCR(int channel) const override;
-};
+		// Reads BCL text as written by writeBCR back into its presets
+		static std::vector<Rev2BCLPreset> parseBCL(std::string const &bcl);
 
-class Rev2BCR2000 {
-public:
-	static std::string generateBCR(Rev2 &rev2, int baseStoragePlace, bool includeHeaderAndFooter = true);
+		// Checks parsed presets against the Rev2 parameter table, returns a description of every problem found
+		static std::vector<std::string> checkPresets(std::vector<Rev2BCLPreset> const &presets, MidiChannel channel);
 
-private:
-	static std::vector<Rev2BCR2000Definition *> explodeBy8(std::vector<Rev2BCR2000Definition *> const &controllerSetup, int nrpnOffset = 0);
-	static std::string generateMapping(std::string const &presetName, int midiChannel, int storagePlace, int additionalNRPNOffset);
-};
+	private:
+		static void explodeBy8(std::vector<Rev2BCR2000Control> const &controllerSetup, int nrpnOffset, std::vector<Rev2BCR2000Control> &result);
+		static void writeMapping(std::ostream &out, std::string const &presetName, int midiChannel, int storagePlace, int additionalNRPNOffset, std::vector<Rev2BCR2000Control> &arena);
+		static void writeControl(std::ostream &out, Rev2BCR2000Control const &control, int channel);
+	};
 
+}
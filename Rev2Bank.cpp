@@ -0,0 +1,112 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2Bank.h"
+
+#include "Rev2Patch.h"
+
+#include <algorithm>
+
+namespace midikraft {
+
+	Rev2Bank::Rev2Bank(size_t expectedPatches)
+	{
+		arena_.reserve(expectedPatches * kPatchSize);
+		places_.reserve(expectedPatches);
+	}
+
+	uint8 * Rev2Bank::appendUninitialized(MidiProgramNumber place)
+	{
+		places_.push_back(place);
+		arena_.resize(places_.size() * kPatchSize);
+		return &arena_[(places_.size() - 1) * kPatchSize];
+	}
+
+	Rev2Bank::Handle Rev2Bank::append(MidiProgramNumber place, const uint8 *data, size_t size)
+	{
+		jassert(size <= kPatchSize);
+		uint8 *destination = appendUninitialized(place);
+		size_t bytes = std::min(size, kPatchSize);
+		std::copy(data, data + bytes, destination);
+		std::fill(destination + bytes, destination + kPatchSize, (uint8)0);
+		return Handle(this, places_.size() - 1);
+	}
+
+	void Rev2Bank::clear()
+	{
+		std::vector<uint8>().swap(arena_);
+		std::vector<MidiProgramNumber>().swap(places_);
+	}
+
+	std::vector<std::shared_ptr<DataFile>> Rev2Bank::toPatches() const
+	{
+		std::vector<std::shared_ptr<DataFile>> result;
+		result.reserve(size());
+		for (size_t i = 0; i < size(); i++) {
+			result.push_back(std::make_shared<Rev2Patch>(Synth::PatchData(patchData(i), patchData(i) + kPatchSize), places_[i]));
+		}
+		return result;
+	}
+
+	MidiProgramNumber Rev2Bank::Handle::patchNumber() const
+	{
+		return bank_->places_[index_];
+	}
+
+	const uint8 * Rev2Bank::Handle::data() const
+	{
+		return &bank_->arena_[index_ * kPatchSize];
+	}
+
+	uint8 * Rev2Bank::Handle::data()
+	{
+		return &bank_->arena_[index_ * kPatchSize];
+	}
+
+	int Rev2Bank::Handle::at(int sysExIndex) const
+	{
+		jassert(sysExIndex >= 0 && sysExIndex < (int)kPatchSize);
+		return data()[sysExIndex];
+	}
+
+	void Rev2Bank::Handle::setAt(int sysExIndex, uint8 value)
+	{
+		jassert(sysExIndex >= 0 && sysExIndex < (int)kPatchSize);
+		data()[sysExIndex] = value;
+	}
+
+	std::string Rev2Bank::Handle::name() const
+	{
+		return Rev2Patch::nameOf(data());
+	}
+
+	LayeredPatchCapability::LayerMode Rev2Bank::Handle::layerMode() const
+	{
+		return Rev2Patch::layerModeOf(data());
+	}
+
+	std::string Rev2Bank::Handle::layerName(int layerNo) const
+	{
+		jassert(layerNo == 0 || layerNo == 1);
+		return Rev2Patch::layerNameOf(data(), layerNo);
+	}
+
+	void Rev2Bank::Handle::setLayerName(int layerNo, std::string const &layerName)
+	{
+		jassert(layerNo == 0 || layerNo == 1);
+		int baseIndex = layerNo == 0 ? 235 : 1259; // Layer A starts at 235, Layer B starts at 1259
+		for (int i = 0; i < 20; i++) {
+			// Fill the 20 characters with space
+			setAt(baseIndex + i, i < (int)layerName.size() ? (uint8)layerName[i] : (uint8)' ');
+		}
+	}
+
+	std::shared_ptr<Rev2Patch> Rev2Bank::Handle::toPatch() const
+	{
+		return std::make_shared<Rev2Patch>(Synth::PatchData(data(), data() + kPatchSize), patchNumber());
+	}
+
+}
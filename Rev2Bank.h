@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+#include "LayeredPatchCapability.h"
+
+namespace midikraft {
+
+	class Rev2Patch;
+
+	// All decoded patches of one or more banks in a single contiguous buffer, 2048 bytes per patch.
+	// Loading a bank of 1024 programs this way makes two allocations instead of several per program,
+	// iterating over the patches walks linear memory, and clearing the bank frees everything at once.
+	class Rev2Bank {
+	public:
+		static constexpr size_t kPatchSize = 2048;
+
+		// A cheap reference to one patch in the bank, offering the patch capabilities directly on the bank's memory.
+		// It stays valid while the bank grows, but not after the bank is cleared or destroyed
+		class Handle {
+		public:
+			Handle(Rev2Bank *bank, size_t index) : bank_(bank), index_(index) {}
+
+			size_t index() const { return index_; }
+			MidiProgramNumber patchNumber() const;
+
+			const uint8 *data() const;
+			uint8 *data();
+			int at(int sysExIndex) const;
+			void setAt(int sysExIndex, uint8 value);
+
+			std::string name() const;
+			LayeredPatchCapability::LayerMode layerMode() const;
+			std::string layerName(int layerNo) const;
+			void setLayerName(int layerNo, std::string const &layerName);
+
+			// For code that needs a full DataFile, e.g. the librarian. This copies the patch data
+			std::shared_ptr<Rev2Patch> toPatch() const;
+
+		private:
+			Rev2Bank *bank_;
+			size_t index_;
+		};
+
+		Rev2Bank() = default;
+		explicit Rev2Bank(size_t expectedPatches);
+
+		// Returns the place for the decoded data, to be filled by the caller
+		uint8 *appendUninitialized(MidiProgramNumber place);
+		Handle append(MidiProgramNumber place, const uint8 *data, size_t size);
+
+		size_t size() const { return places_.size(); }
+		bool empty() const { return places_.empty(); }
+		Handle operator[](size_t index) { jassert(index < size()); return Handle(this, index); }
+		const uint8 *patchData(size_t index) const { jassert(index < size()); return &arena_[index * kPatchSize]; }
+		MidiProgramNumber place(size_t index) const { return places_[index]; }
+
+		// Releases the memory of all patches
+		void clear();
+
+		// One Rev2Patch per program, for the DataFile based interfaces
+		std::vector<std::shared_ptr<DataFile>> toPatches() const;
+
+	private:
+		std::vector<uint8> arena_;
+		std::vector<MidiProgramNumber> places_;
+	};
+
+}
@@ -0,0 +1,185 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2BankValidator.h"
+
+#include "Rev2ParamLayout.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REV2_VALIDATOR_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define REV2_VALIDATOR_NEON
+#endif
+
+namespace midikraft {
+
+	struct ValueRanges {
+		alignas(16) uint8 minValue[Rev2BankValidator::kPatchSize];
+		alignas(16) uint8 maxValue[Rev2BankValidator::kPatchSize];
+	};
+
+	constexpr bool isPolySequencer(Rev2Param param) {
+		return param >= Rev2Param::PolySeqNote1 && param <= Rev2Param::PolySeqVel6;
+	}
+
+	constexpr ValueRanges buildValueRanges() {
+		ValueRanges result = {};
+		for (size_t i = 0; i < Rev2BankValidator::kPatchSize; i++) {
+			result.minValue[i] = 0;
+			result.maxValue[i] = 255;
+		}
+		for (auto const &p : kRev2ParamLayout) {
+			if (isPolySequencer(p.param)) continue;
+			for (int layerStart : { 0, kSysexStartLayerB }) {
+				for (int i = p.sysexIndex; i <= p.endSysexIndex(); i++) {
+					result.minValue[layerStart + i] = (uint8)p.minValue;
+					result.maxValue[layerStart + i] = (uint8)p.maxValue;
+				}
+			}
+		}
+		return result;
+	}
+
+	constexpr ValueRanges kValueRanges = buildValueRanges();
+
+	bool Rev2BankValidator::isValid(Synth::PatchData const &data)
+	{
+		return data.size() == kPatchSize && isValid(data.data());
+	}
+
+	bool Rev2BankValidator::isValid(const uint8 *data)
+	{
+#if defined(REV2_VALIDATOR_SSE2)
+		// SSE2 has no unsigned byte compare, but v is in [lo, hi] exactly when max(v, lo) == v and min(v, hi) == v
+		__m128i allInRange = _mm_set1_epi8(-1);
+		for (size_t i = 0; i < kPatchSize; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+			__m128i lo = _mm_load_si128(reinterpret_cast<const __m128i *>(kValueRanges.minValue + i));
+			__m128i hi = _mm_load_si128(reinterpret_cast<const __m128i *>(kValueRanges.maxValue + i));
+			__m128i inRange = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v), _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+			allInRange = _mm_and_si128(allInRange, inRange);
+		}
+		return _mm_movemask_epi8(allInRange) == 0xffff;
+#elif defined(REV2_VALIDATOR_NEON)
+		uint8x16_t allInRange = vdupq_n_u8(0xff);
+		for (size_t i = 0; i < kPatchSize; i += 16) {
+			uint8x16_t v = vld1q_u8(data + i);
+			uint8x16_t inRange = vandq_u8(vcgeq_u8(v, vld1q_u8(kValueRanges.minValue + i)), vcleq_u8(v, vld1q_u8(kValueRanges.maxValue + i)));
+			allInRange = vandq_u8(allInRange, inRange);
+		}
+		return vminvq_u8(allInRange) == 0xff;
+#else
+		bool allInRange = true;
+		for (size_t i = 0; i < kPatchSize; i++) {
+			allInRange &= data[i] >= kValueRanges.minValue[i] && data[i] <= kValueRanges.maxValue[i];
+		}
+		return allInRange;
+#endif
+	}
+
+	void Rev2BankValidator::describe(const uint8 *data, PatchReport &report)
+	{
+		for (size_t i = 0; i < kPatchSize; i++) {
+			if (data[i] < kValueRanges.minValue[i] || data[i] > kValueRanges.maxValue[i]) {
+				Violation violation;
+				violation.sysexIndex = (int)i;
+				violation.layer = i < (size_t)kSysexStartLayerB ? 0 : 1;
+				violation.value = data[i];
+				violation.minValue = kValueRanges.minValue[i];
+				violation.maxValue = kValueRanges.maxValue[i];
+				auto param = Rev2ParamLayout::findByNRPN(Rev2ParamLayout::nrpnForSysexIndex((int)i));
+				violation.parameterName = param ? param->name : "unknown";
+				report.violations.push_back(violation);
+			}
+		}
+	}
+
+	Rev2BankValidator::PatchReport Rev2BankValidator::validate(Synth::PatchData const &data, size_t patchIndex /* = 0 */)
+	{
+		PatchReport report;
+		report.patchIndex = patchIndex;
+		if (data.size() != kPatchSize) {
+			report.wrongSize = true;
+		}
+		else if (!isValid(data.data())) {
+			describe(data.data(), report);
+		}
+		return report;
+	}
+
+	std::vector<Rev2BankValidator::PatchReport> Rev2BankValidator::validateBank(std::vector<std::shared_ptr<DataFile>> const &patches)
+	{
+		std::vector<PatchReport> result;
+		for (size_t i = 0; i < patches.size(); i++) {
+			if (!patches[i] || !isValid(patches[i]->data())) {
+				PatchReport report;
+				report.patchIndex = i;
+				if (patches[i]) {
+					report = validate(patches[i]->data(), i);
+				}
+				else {
+					report.wrongSize = true;
+				}
+				result.push_back(report);
+			}
+		}
+		return result;
+	}
+
+	std::vector<Rev2BankValidator::PatchReport> Rev2BankValidator::validateBank(const uint8 *data, size_t numberOfPatches, size_t stride /* = kPatchSize */)
+	{
+		jassert(stride >= kPatchSize);
+		std::vector<PatchReport> result;
+		for (size_t i = 0; i < numberOfPatches; i++) {
+			const uint8 *patch = data + i * stride;
+			if (!isValid(patch)) {
+				PatchReport report;
+				report.patchIndex = i;
+				describe(patch, report);
+				result.push_back(report);
+			}
+		}
+		return result;
+	}
+
+	int Rev2BankValidator::clamp(Synth::PatchData &data)
+	{
+		jassert(data.size() == kPatchSize);
+		if (data.size() != kPatchSize || isValid(data.data())) {
+			return 0;
+		}
+		int changed = 0;
+		for (size_t i = 0; i < kPatchSize; i++) {
+			uint8 clamped = std::min(std::max(data[i], kValueRanges.minValue[i]), kValueRanges.maxValue[i]);
+			if (clamped != data[i]) {
+				data[i] = clamped;
+				changed++;
+			}
+		}
+		return changed;
+	}
+
+	int Rev2BankValidator::clamp(DataFile &patch)
+	{
+		auto const &data = patch.data();
+		if (data.size() != kPatchSize || isValid(data.data())) {
+			return 0;
+		}
+		int changed = 0;
+		for (size_t i = 0; i < kPatchSize; i++) {
+			uint8 value = patch.data()[i];
+			uint8 clamped = std::min(std::max(value, kValueRanges.minValue[i]), kValueRanges.maxValue[i]);
+			if (clamped != value) {
+				patch.setAt((int)i, clamped);
+				changed++;
+			}
+		}
+		return changed;
+	}
+
+}
@@ -0,0 +1,56 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+
+namespace midikraft {
+
+	// Checks Rev2 patch data against the value ranges of the parameter layout, e.g. to catch truncated or corrupt dumps
+	// before they end up in the database. The min and max values of all 2048 bytes are precomputed at compile time, and
+	// the check compares 16 bytes at a time with SSE2 or NEON where available.
+	// Bytes not covered by a parameter and the poly sequencer steps (which also store ties and rests) accept any value.
+	class Rev2BankValidator {
+	public:
+		static constexpr size_t kPatchSize = 2048;
+
+		struct Violation {
+			int sysexIndex;
+			int layer;
+			uint8 value;
+			uint8 minValue;
+			uint8 maxValue;
+			std::string parameterName;
+		};
+
+		struct PatchReport {
+			size_t patchIndex = 0;
+			bool wrongSize = false;
+			std::vector<Violation> violations;
+
+			bool isValid() const { return !wrongSize && violations.empty(); }
+		};
+
+		// Fast check only, true if the data has the right size and all values are in range
+		static bool isValid(Synth::PatchData const &data);
+		static bool isValid(const uint8 *data);
+
+		static PatchReport validate(Synth::PatchData const &data, size_t patchIndex = 0);
+		// Only the reports of invalid patches are returned
+		static std::vector<PatchReport> validateBank(std::vector<std::shared_ptr<DataFile>> const &patches);
+		static std::vector<PatchReport> validateBank(const uint8 *data, size_t numberOfPatches, size_t stride = kPatchSize);
+
+		// Clamps all values into their valid range, returns the number of bytes changed
+		static int clamp(Synth::PatchData &data);
+		// Writes only the changed bytes, so valid patches keep sharing their data
+		static int clamp(DataFile &patch);
+
+	private:
+		static void describe(const uint8 *data, PatchReport &report);
+	};
+
+}
@@ -6,8 +6,12 @@
 #include "Rev2.h"
 #include "Rev2Patch.h"
 
+#include <boost/format.hpp>
+
+using namespace midikraft;
+
 Rev2ButtonStrip::Rev2ButtonStrip(Rev2 &rev2, MidiController *controller, EditBufferHandler *handler, SimpleLogger *logger) : 
-	LambdaButtonStrip(), isLocked_(false), handler_(handler), currentPatch_(nullptr)
+	LambdaButtonStrip(), handler_(handler), sequenceLock_(std::make_shared<Rev2SequenceLock>(rev2.shared_from_this()))
 {
 	LambdaButtonStrip::TButtonMap buttonDefs = {
 	{ "poly2gate",{ "Copy Poly to Gated", [this, controller, handler, logger, &rev2]() {
@@ -49,10 +53,10 @@ Rev2ButtonStrip::Rev2ButtonStrip(Rev2 &rev2, MidiController *controller, EditBuf
 	} } },
 	{ "makeSeqPersist",{ "Lock Poly and Gated sequence", [this, controller, handler, logger, &rev2]() {
 		auto handle = EditBufferHandler::makeOne();
-		handler->setNextEditBufferHandler(handle, [this, handle, handler, logger, &rev2](MidiMessage const &message) {
-			lockedSequence_ = message;
+		handler->setNextEditBufferHandler(handle, [this, handle, handler, logger](MidiMessage const &message) {
+			// Do the expensive part once now, so the program change only needs to splice bytes
+			sequenceLock_->lock(message);
 			logger->postMessage("Retrieved sequences from current program and locked them.");
-			isLocked_ = true;
 			handler->removeEditBufferHandler(handle);
 		});
 		controller->getMidiOutput(rev2.midiOutput())->sendMessageNow(rev2.requestEditBufferDump());
@@ -60,37 +64,14 @@ Rev2ButtonStrip::Rev2ButtonStrip(Rev2 &rev2, MidiController *controller, EditBuf
 	};
 	setButtonDefinitions(buttonDefs);
 
-	// And we need one more midi handler that will stay for the whole runtime of the program, reacting only on program change messages from the Rev2
+	// And we need one more midi handler that will stay for the whole runtime of the program. The sequence lock reacts on the program changes
+	// from the Rev2, and restores the locked sequences into the edit buffer it requests
 	programChangeHandle_ = EditBufferHandler::makeOne();
-	handler->setNextEditBufferHandler(programChangeHandle_, [this, handler, &rev2, controller, logger](MidiMessage const &message) {
+	handler->setNextEditBufferHandler(programChangeHandle_, [this, controller, &rev2](MidiMessage const &message) {
 		if (message.isProgramChange()) {
-			if (isLocked_) {
-				// New feature: make the poly and gated sequences survive a program change by patching them immediately back in!
-				auto handle = EditBufferHandler::makeOne();
-				handler->setNextEditBufferHandler(handle, [this, handle, &rev2, handler, controller, logger](MidiMessage const &message) {
-					if (rev2.isEditBufferDump(message)) {
-						currentPatch_ = rev2.patchFromSysex(message);
-						auto patchedBack = rev2.copySequencersFromOther(message, lockedSequence_);
-						controller->getMidiOutput(rev2.midiOutput())->sendMessageNow(patchedBack);
-						logger->postMessage("Program change - Restored all sequences from locked data");
-						handler->removeEditBufferHandler(handle);
-					}
-				});
-				controller->enableMidiInput(rev2.midiInput());
-				controller->getMidiOutput(rev2.midiOutput())->sendMessageNow(rev2.requestEditBufferDump());
-			}
-			else {
-				auto handle = EditBufferHandler::makeOne();
-				handler->setNextEditBufferHandler(handle, [this, handle, handler, logger, &rev2](MidiMessage const &message) {
-					if (rev2.isEditBufferDump(message)) {
-						currentPatch_ = rev2.patchFromSysex(message);
-						logger->postMessage("Retrieved new patch after program change");
-						handler->removeEditBufferHandler(handle);
-					}
-				});
-				controller->getMidiOutput(rev2.midiOutput())->sendMessageNow(rev2.requestEditBufferDump());
-			}
+			controller->enableMidiInput(rev2.midiInput());
 		}
+		sequenceLock_->handleIncomingMessage(message);
 	});
 }
 
@@ -98,3 +79,7 @@ Rev2ButtonStrip::~Rev2ButtonStrip() {
 	handler_->removeEditBufferHandler(programChangeHandle_);
 }
 
+Rev2SequenceLock::Timing Rev2ButtonStrip::sequenceRestoreTiming() const
+{
+	return sequenceLock_->restoreTiming();
+}
@@ -4,20 +4,21 @@
 
 #include "EditBufferHandler.h"
 
-class Rev2;
-class Patch;
-class MidiController;
+#include "Rev2.h"
+#include "Rev2SequenceLock.h"
+
 class SimpleLogger;
 
 class Rev2ButtonStrip : public LambdaButtonStrip {
 public:
-	Rev2ButtonStrip(Rev2 &rev2, MidiController *controller, EditBufferHandler *handler, SimpleLogger *logger);
+	Rev2ButtonStrip(midikraft::Rev2 &rev2, midikraft::MidiController *controller, EditBufferHandler *handler, SimpleLogger *logger);
 	virtual ~Rev2ButtonStrip();
 
+	// Time from receiving the program change to sending out the edit buffer with the restored sequences
+	midikraft::Rev2SequenceLock::Timing sequenceRestoreTiming() const;
+
 private:
 	EditBufferHandler::HandlerHandle programChangeHandle_;
 	EditBufferHandler *handler_;
-	bool isLocked_;
-	MidiMessage lockedSequence_;
-	std::shared_ptr<Patch> currentPatch_;
+	std::shared_ptr<midikraft::Rev2SequenceLock> sequenceLock_;
 };
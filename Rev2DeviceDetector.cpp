@@ -0,0 +1,81 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2DeviceDetector.h"
+
+#include "Rev2Trace.h"
+
+namespace midikraft {
+
+	Rev2DeviceDetector::Rev2DeviceDetector(std::shared_ptr<DSISynth> synth) : synth_(synth), outstanding_(0), startTime_(0.0)
+	{
+	}
+
+	std::vector<Rev2DeviceDetector::Result> Rev2DeviceDetector::detect(std::vector<Candidate> const &candidates)
+	{
+		Rev2TraceSpan span("parallelDetect", (int64) candidates.size());
+		auto detectMessages = synth_->deviceDetect(0); // DSI synths don't need channel specific detection
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			running_.clear();
+			for (auto const &candidate : candidates) {
+				Result result;
+				result.ports = candidate;
+				running_.push_back(result);
+			}
+			outstanding_ = (int) candidates.size();
+			startTime_ = Time::getMillisecondCounterHiRes();
+		}
+		// Send all requests right away, the replies are collected by handleIncomingMessage() while we wait. The synth's send
+		// records them in an active traffic capture
+		Rev2TraceSpan roundTrip("deviceDetect", (int64) candidates.size());
+		for (auto const &candidate : candidates) {
+			synth_->sendBlockOfMessagesToSynth(candidate.midiOutput, detectMessages);
+		}
+
+		std::unique_lock<std::mutex> lock(lock_);
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(synth_->deviceDetectSleepMS());
+		replyArrived_.wait_until(lock, deadline, [this]() { return outstanding_ == 0; });
+		double waited = Time::getMillisecondCounterHiRes() - startTime_;
+		for (auto &result : running_) {
+			if (!result.detected) {
+				result.millisecondsToDetect = waited;
+			}
+		}
+		outstanding_ = 0; // Late replies are ignored
+		return running_;
+	}
+
+	std::future<std::vector<Rev2DeviceDetector::Result>> Rev2DeviceDetector::detectAsync(std::vector<Candidate> const &candidates)
+	{
+		return std::async(std::launch::async, [this, candidates]() { return detect(candidates); });
+	}
+
+	void Rev2DeviceDetector::handleIncomingMessage(std::string const &midiInput, MidiMessage const &message)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (outstanding_ == 0) {
+			return;
+		}
+		for (auto &result : running_) {
+			if (!result.detected && result.ports.midiInput == midiInput) {
+				MidiChannel channel = synth_->channelIfValidDeviceResponse(message);
+				if (channel.isValid()) {
+					result.detected = true;
+					result.channel = channel;
+					result.millisecondsToDetect = Time::getMillisecondCounterHiRes() - startTime_;
+					Rev2Trace::instance().recordInstant("deviceDetected", "rev2", (int64) result.millisecondsToDetect);
+					if (--outstanding_ == 0) {
+						replyArrived_.notify_all();
+					}
+				}
+				// One reply only finishes one candidate, even if several share this input
+				break;
+			}
+		}
+	}
+
+}
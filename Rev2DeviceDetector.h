@@ -0,0 +1,53 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "DSI.h"
+
+#include <condition_variable>
+#include <future>
+
+namespace midikraft {
+
+	// Detects a DSI synth on many port pairs at once. The identity request is sent on all candidate outputs together, and each
+	// candidate finishes as soon as its input delivers a valid reply. The synth's deviceDetectSleepMS() is only the upper bound
+	// for candidates that do not answer, so detecting on n ports takes one turnaround instead of n times the sleep.
+	class Rev2DeviceDetector {
+	public:
+		struct Candidate {
+			std::string midiInput;
+			std::string midiOutput;
+		};
+
+		struct Result {
+			Candidate ports;
+			bool detected = false;
+			MidiChannel channel = MidiChannel::invalidChannel();
+			double millisecondsToDetect = 0.0; // Time until the reply arrived, or the time waited if there was none
+		};
+
+		Rev2DeviceDetector(std::shared_ptr<DSISynth> synth);
+
+		// Blocks until all candidates have answered or the timeout is over. Results are in the order of the candidates.
+		// Only one detection can run at a time per detector
+		std::vector<Result> detect(std::vector<Candidate> const &candidates);
+		std::future<std::vector<Result>> detectAsync(std::vector<Candidate> const &candidates);
+
+		// Feed all messages received during detection in here
+		void handleIncomingMessage(std::string const &midiInput, MidiMessage const &message);
+
+	private:
+		std::shared_ptr<DSISynth> synth_;
+
+		std::mutex lock_;
+		std::condition_variable replyArrived_;
+		std::vector<Result> running_;
+		int outstanding_;
+		double startTime_;
+	};
+
+}
@@ -0,0 +1,319 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2DeviceManager.h"
+
+#include "Rev2Trace.h"
+
+#include <algorithm>
+#include <boost/format.hpp>
+
+namespace midikraft {
+
+	// Nobody waits for more than a full bank dump, older messages are dropped
+	const size_t kMaxInboxSize = 1024;
+
+	Rev2DeviceConnection::Rev2DeviceConnection(std::shared_ptr<Rev2> synth) : synth_(synth), shouldStop_(false), worker_(&Rev2DeviceConnection::run, this)
+	{
+	}
+
+	Rev2DeviceConnection::~Rev2DeviceConnection()
+	{
+		{
+			std::lock_guard<std::mutex> lock(jobLock_);
+			shouldStop_ = true;
+		}
+		jobAvailable_.notify_all();
+		{
+			// Taking the inbox lock makes sure a job in awaitReply() is either before its stop check or already waiting
+			std::lock_guard<std::mutex> lock(inboxLock_);
+		}
+		messageArrived_.notify_all();
+		worker_.join();
+	}
+
+	std::shared_ptr<Rev2> Rev2DeviceConnection::synth() const
+	{
+		return synth_;
+	}
+
+	void Rev2DeviceConnection::post(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(jobLock_);
+			jobs_.push_back(job);
+		}
+		jobAvailable_.notify_one();
+	}
+
+	void Rev2DeviceConnection::handleIncomingMessage(MidiMessage const &message)
+	{
+		synth_->recordIncoming(message);
+		{
+			std::lock_guard<std::mutex> lock(inboxLock_);
+			inbox_.push_back(message);
+			if (inbox_.size() > kMaxInboxSize) {
+				inbox_.pop_front();
+			}
+		}
+		messageArrived_.notify_one();
+	}
+
+	void Rev2DeviceConnection::send(std::vector<MidiMessage> const &messages)
+	{
+		synth_->sendToSynth(messages);
+	}
+
+	void Rev2DeviceConnection::discardIncomingMessages()
+	{
+		std::lock_guard<std::mutex> lock(inboxLock_);
+		inbox_.clear();
+	}
+
+	bool Rev2DeviceConnection::awaitReply(std::function<bool(MidiMessage const &)> predicate, int timeoutMs, MidiMessage &outReply)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		std::unique_lock<std::mutex> lock(inboxLock_);
+		while (true) {
+			while (!inbox_.empty()) {
+				MidiMessage message = inbox_.front();
+				inbox_.pop_front();
+				if (predicate(message)) {
+					outReply = message;
+					return true;
+				}
+			}
+			{
+				std::lock_guard<std::mutex> jobLock(jobLock_);
+				if (shouldStop_) return false;
+			}
+			if (messageArrived_.wait_until(lock, deadline) == std::cv_status::timeout && inbox_.empty()) {
+				return false;
+			}
+		}
+	}
+
+	std::future<Rev2DeviceConnection::BackupResult> Rev2DeviceConnection::backup(std::vector<MidiProgramNumber> const &programs, int timeoutMs /* = kDefaultReplyTimeoutMs */)
+	{
+		auto promise = std::make_shared<std::promise<BackupResult>>();
+		post([this, promise, programs, timeoutMs]() {
+			Rev2TraceSpan span("deviceBackup", (int64) programs.size());
+			double startTime = Time::getMillisecondCounterHiRes();
+			BackupResult result;
+			for (auto program : programs) {
+				discardIncomingMessages();
+				MidiMessage reply;
+				auto isRequestedProgram = [this, program](MidiMessage const &message) {
+					return synth_->isSingleProgramDump(message) && synth_->getProgramNumber(message).toZeroBased() == program.toZeroBased();
+				};
+				bool replied;
+				{
+					Rev2TraceSpan roundTrip("requestDataItem", program.toZeroBased());
+					send(synth_->requestPatch(program.toZeroBased()));
+					replied = awaitReply(isRequestedProgram, timeoutMs, reply);
+				}
+				if (replied) {
+					auto patch = synth_->patchFromProgramDumpSysex(reply);
+					if (patch) {
+						result.patches.push_back(patch);
+						continue;
+					}
+				}
+				result.missing.push_back(program);
+			}
+			result.milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+			if (!result.missing.empty()) {
+				SimpleLogger::instance()->postMessage((boost::format("Warning: Rev2 on %s did not send %d of %d programs") % synth_->midiOutput() % result.missing.size() % programs.size()).str());
+			}
+			promise->set_value(result);
+		});
+		return promise->get_future();
+	}
+
+	std::future<Rev2DeviceConnection::RestoreResult> Rev2DeviceConnection::restore(std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> const &programs, int delayBetweenProgramsMs)
+	{
+		auto promise = std::make_shared<std::promise<RestoreResult>>();
+		post([this, promise, programs, delayBetweenProgramsMs]() {
+			Rev2TraceSpan span("deviceRestore", (int64) programs.size());
+			double startTime = Time::getMillisecondCounterHiRes();
+			RestoreResult result;
+			for (auto const &program : programs) {
+				if (!program.second) continue;
+				send(synth_->patchToProgramDumpSysex(program.second, program.first));
+				result.programsWritten++;
+				if (!sleepUnlessStopped(delayBetweenProgramsMs)) {
+					// The device is being removed, the result shows how far we got
+					break;
+				}
+			}
+			result.milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+			promise->set_value(result);
+		});
+		return promise->get_future();
+	}
+
+	std::future<Rev2DeviceConnection::VerifiedRestoreResult> Rev2DeviceConnection::verifiedRestore(std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> const &programs, int readBackLag /* = 2 */,
+		int maxRetries /* = 2 */, int timeoutMs /* = kDefaultReplyTimeoutMs */)
+	{
+		auto promise = std::make_shared<std::promise<VerifiedRestoreResult>>();
+		post([this, promise, programs, readBackLag, maxRetries, timeoutMs]() {
+			Rev2TraceSpan span("deviceVerifiedRestore", (int64) programs.size());
+			double startTime = Time::getMillisecondCounterHiRes();
+			VerifiedRestoreResult result;
+
+			std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> pending;
+			std::copy_if(programs.begin(), programs.end(), std::back_inserter(pending), [](std::pair<MidiProgramNumber, std::shared_ptr<DataFile>> const &program) { return program.second != nullptr; });
+			for (int attempt = 0; attempt <= maxRetries && !pending.empty(); attempt++) {
+				if (attempt > 0) {
+					result.retries++;
+				}
+				std::vector<uint64> fingerprints;
+				std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> mismatches;
+				discardIncomingMessages();
+				size_t nextReadBack = 0;
+				auto readBack = [&]() {
+					auto const &program = pending[nextReadBack];
+					if (readBackMatches(program.first, fingerprints[nextReadBack], timeoutMs, result)) {
+						result.programsVerified++;
+					}
+					else {
+						mismatches.push_back(program);
+					}
+					nextReadBack++;
+				};
+				for (size_t i = 0; i < pending.size(); i++) {
+					auto messages = synth_->patchToProgramDumpSysex(pending[i].second, pending[i].first);
+					for (auto const &message : messages) result.bytesSent += (size_t)message.getRawDataSize();
+					send(messages);
+					result.programsWritten++;
+					fingerprints.push_back(Rev2::voiceFingerprint(pending[i].second->data()));
+					if (i >= (size_t)readBackLag) {
+						readBack();
+					}
+				}
+				// Drain the pipeline
+				while (nextReadBack < pending.size()) {
+					readBack();
+				}
+				pending = mismatches;
+			}
+			for (auto const &program : pending) {
+				result.failed.push_back(program.first);
+			}
+			result.milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+			SimpleLogger::instance()->postMessage((boost::format("Rev2 on %s: verified %d programs in %.1f s (%.1f programs/s, %.0f bytes/s), %d retries, %d failed")
+				% synth_->midiOutput() % result.programsVerified % (result.milliseconds / 1000.0) % result.programsPerSecond() % result.bytesPerSecond() % result.retries % result.failed.size()).str());
+			promise->set_value(result);
+		});
+		return promise->get_future();
+	}
+
+	bool Rev2DeviceConnection::readBackMatches(MidiProgramNumber program, uint64 expectedFingerprint, int timeoutMs, VerifiedRestoreResult &result)
+	{
+		MidiMessage reply;
+		auto isRequestedProgram = [this, program](MidiMessage const &message) {
+			return synth_->isSingleProgramDump(message) && synth_->getProgramNumber(message).toZeroBased() == program.toZeroBased();
+		};
+		{
+			// With the read back lag, this also includes waiting behind the program dumps sent before the request
+			Rev2TraceSpan roundTrip("requestDataItem", program.toZeroBased());
+			send(synth_->requestPatch(program.toZeroBased()));
+			if (!awaitReply(isRequestedProgram, timeoutMs, reply)) {
+				return false;
+			}
+		}
+		result.bytesReceived += (size_t)reply.getRawDataSize();
+		auto patch = synth_->patchFromProgramDumpSysex(reply);
+		return patch && Rev2::voiceFingerprint(patch->data()) == expectedFingerprint;
+	}
+
+	bool Rev2DeviceConnection::sleepUnlessStopped(int milliseconds)
+	{
+		// The destructor wakes up everybody waiting for a job, so this returns right away on shutdown
+		std::unique_lock<std::mutex> lock(jobLock_);
+		return !jobAvailable_.wait_for(lock, std::chrono::milliseconds(milliseconds), [this]() { return shouldStop_; });
+	}
+
+	void Rev2DeviceConnection::run()
+	{
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(jobLock_);
+				jobAvailable_.wait(lock, [this]() { return shouldStop_ || !jobs_.empty(); });
+				if (shouldStop_) {
+					// Dropping the remaining jobs breaks their promises, so nobody waits forever
+					jobs_.clear();
+					return;
+				}
+				job = jobs_.front();
+				jobs_.pop_front();
+			}
+			job();
+		}
+	}
+
+	std::shared_ptr<Rev2DeviceConnection> Rev2DeviceManager::addDevice(std::shared_ptr<Rev2> synth)
+	{
+		auto connection = std::make_shared<Rev2DeviceConnection>(synth);
+		std::lock_guard<std::mutex> lock(lock_);
+		devices_.push_back(connection);
+		return connection;
+	}
+
+	void Rev2DeviceManager::removeDevice(std::shared_ptr<Rev2> synth)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		devices_.erase(std::remove_if(devices_.begin(), devices_.end(), [synth](std::shared_ptr<Rev2DeviceConnection> const &device) {
+			return device->synth() == synth;
+		}), devices_.end());
+	}
+
+	std::vector<std::shared_ptr<Rev2DeviceConnection>> Rev2DeviceManager::devices() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return devices_;
+	}
+
+	void Rev2DeviceManager::handleIncomingMessage(std::string const &midiInput, MidiMessage const &message)
+	{
+		for (auto const &device : devices()) {
+			if (device->synth()->midiInput() == midiInput) {
+				device->handleIncomingMessage(message);
+			}
+		}
+	}
+
+	std::vector<Rev2DeviceConnection::BackupResult> Rev2DeviceManager::backupAll(std::vector<MidiProgramNumber> const &programs, int timeoutMs /* = Rev2DeviceConnection::kDefaultReplyTimeoutMs */)
+	{
+		// Start all devices first, then collect, so the devices work in parallel
+		std::vector<std::future<Rev2DeviceConnection::BackupResult>> running;
+		for (auto const &device : devices()) {
+			running.push_back(device->backup(programs, timeoutMs));
+		}
+		std::vector<Rev2DeviceConnection::BackupResult> result;
+		for (auto &future : running) {
+			result.push_back(future.get());
+		}
+		return result;
+	}
+
+	std::vector<Rev2DeviceConnection::RestoreResult> Rev2DeviceManager::restoreAll(std::vector<std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>>> const &programsPerDevice, int delayBetweenProgramsMs)
+	{
+		auto allDevices = devices();
+		jassert(programsPerDevice.size() == allDevices.size());
+		std::vector<std::future<Rev2DeviceConnection::RestoreResult>> running;
+		for (size_t i = 0; i < allDevices.size() && i < programsPerDevice.size(); i++) {
+			running.push_back(allDevices[i]->restore(programsPerDevice[i], delayBetweenProgramsMs));
+		}
+		std::vector<Rev2DeviceConnection::RestoreResult> result;
+		for (auto &future : running) {
+			result.push_back(future.get());
+		}
+		return result;
+	}
+
+}
@@ -0,0 +1,116 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Rev2.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <thread>
+
+namespace midikraft {
+
+	// One Rev2 on its own port and channel, with a worker thread that executes all request/reply exchanges with this device in order.
+	// Incoming messages are not read from the MIDI ports directly, the host feeds them in via handleIncomingMessage()
+	// (usually through the Rev2DeviceManager), so this works with whatever MIDI input handling the application has.
+	class Rev2DeviceConnection {
+	public:
+		static const int kDefaultReplyTimeoutMs = 2000;
+
+		struct BackupResult {
+			std::vector<std::shared_ptr<DataFile>> patches;
+			std::vector<MidiProgramNumber> missing; // Programs that did not reply within the timeout
+			double milliseconds = 0.0;
+		};
+
+		struct RestoreResult {
+			int programsWritten = 0;
+			double milliseconds = 0.0;
+		};
+
+		struct VerifiedRestoreResult {
+			int programsWritten = 0; // Including the retries
+			int programsVerified = 0;
+			int retries = 0;
+			std::vector<MidiProgramNumber> failed; // Still different or not read back after the last retry
+			size_t bytesSent = 0;
+			size_t bytesReceived = 0;
+			double milliseconds = 0.0;
+
+			double programsPerSecond() const { return milliseconds > 0.0 ? programsVerified * 1000.0 / milliseconds : 0.0; }
+			double bytesPerSecond() const { return milliseconds > 0.0 ? (bytesSent + bytesReceived) * 1000.0 / milliseconds : 0.0; }
+		};
+
+		Rev2DeviceConnection(std::shared_ptr<Rev2> synth);
+		~Rev2DeviceConnection();
+
+		std::shared_ptr<Rev2> synth() const;
+
+		// Queues a job for the worker thread of this device. Jobs run one at a time, in the order posted
+		void post(std::function<void()> job);
+		// Thread safe, to be called from the MIDI input callback
+		void handleIncomingMessage(MidiMessage const &message);
+
+		// The following are meant to be called from within a job only
+		void send(std::vector<MidiMessage> const &messages);
+		void discardIncomingMessages();
+		// Waits for the first incoming message the predicate accepts. Messages not accepted are discarded
+		bool awaitReply(std::function<bool(MidiMessage const &)> predicate, int timeoutMs, MidiMessage &outReply);
+
+		// Requests the programs one after the other, waiting for each reply
+		std::future<BackupResult> backup(std::vector<MidiProgramNumber> const &programs, int timeoutMs = kDefaultReplyTimeoutMs);
+		// Sends the program dumps, with a pause in between to give the synth time to store each program
+		std::future<RestoreResult> restore(std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> const &programs, int delayBetweenProgramsMs);
+		// Like restore, but reads every program back and compares its voice fingerprint with what was sent. The read-back of a program
+		// is requested readBackLag programs after its write, which gives the synth time to store it while the pipeline keeps moving.
+		// Programs that differ or don't reply are written again, up to maxRetries times
+		std::future<VerifiedRestoreResult> verifiedRestore(std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> const &programs, int readBackLag = 2,
+			int maxRetries = 2, int timeoutMs = kDefaultReplyTimeoutMs);
+
+	private:
+		void run();
+		bool readBackMatches(MidiProgramNumber program, uint64 expectedFingerprint, int timeoutMs, VerifiedRestoreResult &result);
+		// Sleeps unless the connection is shut down meanwhile. Returns false if it was
+		bool sleepUnlessStopped(int milliseconds);
+
+		std::shared_ptr<Rev2> synth_;
+
+		std::mutex jobLock_;
+		std::condition_variable jobAvailable_;
+		std::deque<std::function<void()>> jobs_;
+		bool shouldStop_;
+
+		std::mutex inboxLock_;
+		std::condition_variable messageArrived_;
+		std::deque<MidiMessage> inbox_;
+
+		std::thread worker_; // Last member, so it is started after everything else is initialized
+	};
+
+	// Drives several Rev2 concurrently. Each device has its own worker, so bulk operations take as long as the slowest device,
+	// not as long as all devices together.
+	class Rev2DeviceManager {
+	public:
+		std::shared_ptr<Rev2DeviceConnection> addDevice(std::shared_ptr<Rev2> synth);
+		void removeDevice(std::shared_ptr<Rev2> synth);
+		std::vector<std::shared_ptr<Rev2DeviceConnection>> devices() const;
+
+		// Routes a message received on the given MIDI input to all devices connected to that input
+		void handleIncomingMessage(std::string const &midiInput, MidiMessage const &message);
+
+		// The results are in the order of devices()
+		std::vector<Rev2DeviceConnection::BackupResult> backupAll(std::vector<MidiProgramNumber> const &programs, int timeoutMs = Rev2DeviceConnection::kDefaultReplyTimeoutMs);
+		// programsPerDevice must be in the order of devices()
+		std::vector<Rev2DeviceConnection::RestoreResult> restoreAll(std::vector<std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>>> const &programsPerDevice, int delayBetweenProgramsMs);
+
+	private:
+		mutable std::mutex lock_;
+		std::vector<std::shared_ptr<Rev2DeviceConnection>> devices_;
+	};
+
+}
@@ -0,0 +1,180 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2DeviceSync.h"
+
+#include "Rev2Patch.h"
+#include "Rev2Trace.h"
+
+#include <algorithm>
+#include <sstream>
+#include <boost/format.hpp>
+
+namespace midikraft {
+
+	static bool isValidSlot(MidiProgramNumber place)
+	{
+		return place.toZeroBased() >= 0 && place.toZeroBased() < Rev2SyncManifest::kNumberOfSlots;
+	}
+
+	bool Rev2SyncManifest::knows(MidiProgramNumber place) const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return isValidSlot(place) && known_[place.toZeroBased()];
+	}
+
+	uint64 Rev2SyncManifest::fingerprint(MidiProgramNumber place) const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		jassert(isValidSlot(place));
+		return isValidSlot(place) ? fingerprints_[place.toZeroBased()] : 0;
+	}
+
+	void Rev2SyncManifest::set(MidiProgramNumber place, uint64 fingerprint)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (!isValidSlot(place)) {
+			jassertfalse;
+			return;
+		}
+		fingerprints_[place.toZeroBased()] = fingerprint;
+		known_.set(place.toZeroBased());
+	}
+
+	void Rev2SyncManifest::forget(MidiProgramNumber place)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (isValidSlot(place)) {
+			known_.reset(place.toZeroBased());
+		}
+	}
+
+	void Rev2SyncManifest::clear()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		known_.reset();
+	}
+
+	int Rev2SyncManifest::numberOfKnownSlots() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return (int)known_.count();
+	}
+
+	std::string Rev2SyncManifest::toString() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		std::ostringstream result;
+		for (int slot = 0; slot < kNumberOfSlots; slot++) {
+			if (known_[slot]) {
+				result << slot << ' ' << std::hex << fingerprints_[slot] << std::dec << '\n';
+			}
+		}
+		return result.str();
+	}
+
+	void Rev2SyncManifest::fromString(std::string const &text)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		known_.reset();
+		std::istringstream lines(text);
+		int slot;
+		uint64 fingerprint;
+		while (lines >> std::dec >> slot >> std::hex >> fingerprint) {
+			if (slot >= 0 && slot < kNumberOfSlots) {
+				fingerprints_[slot] = fingerprint;
+				known_.set(slot);
+			}
+		}
+	}
+
+	Rev2DeviceSync::Rev2DeviceSync(std::shared_ptr<Rev2DeviceConnection> device) : device_(device)
+	{
+	}
+
+	Rev2SyncManifest & Rev2DeviceSync::manifest()
+	{
+		return manifest_;
+	}
+
+	Rev2DeviceSync::Plan Rev2DeviceSync::diff(Layout const &target) const
+	{
+		Plan plan;
+		for (auto const &slot : target) {
+			if (!slot.second) continue;
+			if (manifest_.knows(slot.first) && manifest_.fingerprint(slot.first) == Rev2::contentFingerprint(slot.second->data())) {
+				plan.unchanged.push_back(slot.first);
+			}
+			else {
+				plan.changed.push_back(slot);
+			}
+		}
+		return plan;
+	}
+
+	std::future<int> Rev2DeviceSync::refresh(std::vector<MidiProgramNumber> const &slots, int timeoutMs /* = Rev2DeviceConnection::kDefaultReplyTimeoutMs */)
+	{
+		return std::async(std::launch::async, [this, slots, timeoutMs]() {
+			return refreshNow(slots, timeoutMs);
+		});
+	}
+
+	int Rev2DeviceSync::refreshNow(std::vector<MidiProgramNumber> const &slots, int timeoutMs)
+	{
+		// The device's worker does the actual exchange, this thread only waits for it
+		auto backup = device_->backup(slots, timeoutMs).get();
+		for (auto const &patch : backup.patches) {
+			auto rev2Patch = std::dynamic_pointer_cast<Rev2Patch>(patch);
+			if (rev2Patch) {
+				manifest_.set(rev2Patch->patchNumber(), Rev2::contentFingerprint(rev2Patch->data()));
+			}
+		}
+		for (auto const &missing : backup.missing) {
+			manifest_.forget(missing);
+		}
+		return (int)backup.patches.size();
+	}
+
+	std::future<Rev2DeviceSync::SyncResult> Rev2DeviceSync::sync(Layout const &target, bool refreshUnchanged /* = false */)
+	{
+		return std::async(std::launch::async, [this, target, refreshUnchanged]() {
+			Rev2TraceSpan span("deviceSync", (int64)target.size());
+			double startTime = Time::getMillisecondCounterHiRes();
+			SyncResult result;
+			result.slotsInLayout = (int)target.size();
+
+			auto plan = diff(target);
+			if (refreshUnchanged && !plan.unchanged.empty()) {
+				result.slotsRefreshed = refreshNow(plan.unchanged, Rev2DeviceConnection::kDefaultReplyTimeoutMs);
+				plan = diff(target);
+			}
+			result.slotsChanged = (int)plan.changed.size();
+
+			if (!plan.changed.empty()) {
+				result.write = device_->verifiedRestore(plan.changed).get();
+				std::vector<int> failed;
+				for (auto const &place : result.write.failed) {
+					failed.push_back(place.toZeroBased());
+				}
+				for (auto const &slot : plan.changed) {
+					if (std::find(failed.begin(), failed.end(), slot.first.toZeroBased()) != failed.end()) {
+						// We don't know what is in there now
+						manifest_.forget(slot.first);
+					}
+					else {
+						manifest_.set(slot.first, Rev2::contentFingerprint(slot.second->data()));
+					}
+				}
+			}
+
+			result.milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+			SimpleLogger::instance()->postMessage((boost::format("Rev2 sync: %d of %d programs changed, %d read back, %d failed, %.1f s")
+				% result.slotsChanged % result.slotsInLayout % result.slotsRefreshed % result.write.failed.size() % (result.milliseconds / 1000.0)).str());
+			return result;
+		});
+	}
+
+}
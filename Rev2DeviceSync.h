@@ -0,0 +1,82 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Rev2DeviceManager.h"
+
+#include <array>
+#include <bitset>
+
+namespace midikraft {
+
+	// What we believe is stored in each of the 1024 program slots of one Rev2, as content fingerprints. These include the
+	// layer names, a patch that was only renamed must still be written. Thread safe
+	class Rev2SyncManifest {
+	public:
+		static const int kNumberOfSlots = 1024;
+
+		bool knows(MidiProgramNumber place) const;
+		// Only valid if knows(place)
+		uint64 fingerprint(MidiProgramNumber place) const;
+		void set(MidiProgramNumber place, uint64 fingerprint);
+		void forget(MidiProgramNumber place);
+		void clear();
+		int numberOfKnownSlots() const;
+
+		// One line per known slot, to store the manifest together with the device's settings
+		std::string toString() const;
+		void fromString(std::string const &text);
+
+	private:
+		mutable std::mutex lock_;
+		std::array<uint64, kNumberOfSlots> fingerprints_ = {};
+		std::bitset<kNumberOfSlots> known_;
+	};
+
+	// Brings the programs of a Rev2 to a target layout, transferring only the slots that differ from what was last written.
+	// A full bank write over DIN takes minutes, a typical sync of a few edited patches only seconds.
+	class Rev2DeviceSync {
+	public:
+		typedef std::vector<std::pair<MidiProgramNumber, std::shared_ptr<DataFile>>> Layout;
+
+		struct Plan {
+			Layout changed;
+			std::vector<MidiProgramNumber> unchanged;
+		};
+
+		struct SyncResult {
+			int slotsInLayout = 0;
+			int slotsRefreshed = 0; // Read back before diffing, because they might have been edited on the synth
+			int slotsChanged = 0;
+			Rev2DeviceConnection::VerifiedRestoreResult write;
+			double milliseconds = 0.0;
+		};
+
+		Rev2DeviceSync(std::shared_ptr<Rev2DeviceConnection> device);
+
+		Rev2SyncManifest &manifest();
+
+		// Which slots of the layout need to be written according to the manifest
+		Plan diff(Layout const &target) const;
+
+		// Reads the given slots back from the synth and records what is really stored in the manifest.
+		// Slots that don't reply are forgotten, so the next sync writes them
+		std::future<int> refresh(std::vector<MidiProgramNumber> const &slots, int timeoutMs = Rev2DeviceConnection::kDefaultReplyTimeoutMs);
+
+		// Writes the slots of the layout that differ from the manifest, with verification, and updates the manifest.
+		// With refreshUnchanged, the slots the manifest considers up to date are read back first. This is cheaper than writing them,
+		// and catches programs that were edited and stored on the synth itself
+		std::future<SyncResult> sync(Layout const &target, bool refreshUnchanged = false);
+
+	private:
+		int refreshNow(std::vector<MidiProgramNumber> const &slots, int timeoutMs);
+
+		std::shared_ptr<Rev2DeviceConnection> device_;
+		Rev2SyncManifest manifest_;
+	};
+
+}
@@ -0,0 +1,175 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2EditJournal.h"
+
+#include "Rev2ParamLayout.h"
+#include "MidiHelpers.h"
+
+namespace midikraft {
+
+	Rev2EditJournal::Rev2EditJournal(Synth::PatchData const &initialPatch, size_t capacity /* = 4096 */, size_t checkpointInterval /* = 256 */) :
+		ring_(std::max(capacity, (size_t) 1)), checkpointInterval_(std::max(std::min(checkpointInterval, capacity), (size_t) 1)), current_(initialPatch), version_(0), newestVersion_(0)
+	{
+		checkpoints_[0] = std::make_shared<Synth::PatchData>(initialPatch);
+	}
+
+	void Rev2EditJournal::record(int sysexIndex, uint8 oldValue, uint8 newValue)
+	{
+		jassert(sysexIndex >= 0 && sysexIndex < (int)current_.size());
+		jassert(current_[sysexIndex] == oldValue);
+		if (oldValue == newValue) {
+			return;
+		}
+
+		// A new change discards the redo branch
+		if (version_ < newestVersion_) {
+			newestVersion_ = version_;
+			dropCheckpointsAfter(version_);
+		}
+
+		Entry change;
+		change.sysexIndex = (uint16)(sysexIndex % kSysexStartLayerB);
+		change.layer = (uint8)(sysexIndex / kSysexStartLayerB);
+		change.oldValue = oldValue;
+		change.newValue = newValue;
+		version_++;
+		newestVersion_ = version_;
+		ring_[(version_ - 1) % ring_.size()] = change;
+		current_[sysexIndex] = newValue;
+
+		if (version_ % checkpointInterval_ == 0) {
+			checkpoints_[version_] = std::make_shared<Synth::PatchData>(current_);
+		}
+		// Forget the checkpoints that can't be used anymore, because the entries following them have been overwritten
+		while (checkpoints_.begin()->first < oldestVersion()) {
+			checkpoints_.erase(checkpoints_.begin());
+		}
+	}
+
+	void Rev2EditJournal::recordDifferences(Synth::PatchData const &before, Synth::PatchData const &after)
+	{
+		jassert(before.size() == after.size());
+		for (size_t i = 0; i < std::min(before.size(), after.size()); i++) {
+			if (before[i] != after[i]) {
+				record((int)i, before[i], after[i]);
+			}
+		}
+	}
+
+	Synth::PatchData const & Rev2EditJournal::current() const
+	{
+		return current_;
+	}
+
+	uint64 Rev2EditJournal::version() const
+	{
+		return version_;
+	}
+
+	uint64 Rev2EditJournal::newestVersion() const
+	{
+		return newestVersion_;
+	}
+
+	uint64 Rev2EditJournal::oldestVersion() const
+	{
+		// A version can be rebuilt from a checkpoint only if all entries after that checkpoint are still in the ring
+		uint64 firstKeptEntry = newestVersion_ > ring_.size() ? newestVersion_ - ring_.size() + 1 : 1;
+		auto checkpoint = checkpoints_.lower_bound(firstKeptEntry - 1);
+		jassert(checkpoint != checkpoints_.end());
+		return checkpoint != checkpoints_.end() ? checkpoint->first : version_;
+	}
+
+	bool Rev2EditJournal::canUndo() const
+	{
+		return version_ > oldestVersion();
+	}
+
+	bool Rev2EditJournal::canRedo() const
+	{
+		return version_ < newestVersion_;
+	}
+
+	bool Rev2EditJournal::undo()
+	{
+		if (!canUndo()) return false;
+		apply(entry(version_), false, current_);
+		version_--;
+		return true;
+	}
+
+	bool Rev2EditJournal::redo()
+	{
+		if (!canRedo()) return false;
+		version_++;
+		apply(entry(version_), true, current_);
+		return true;
+	}
+
+	bool Rev2EditJournal::gotoVersion(uint64 version)
+	{
+		if (version < oldestVersion() || version > newestVersion_) return false;
+		// Walking is cheaper than rebuilding for the typical few steps of undo
+		if (std::max(version, version_) - std::min(version, version_) > checkpointInterval_) {
+			current_ = rebuild(version);
+			version_ = version;
+			return true;
+		}
+		while (version_ > version) undo();
+		while (version_ < version) redo();
+		return true;
+	}
+
+	Synth::PatchData Rev2EditJournal::rebuild(uint64 version) const
+	{
+		jassert(version >= oldestVersion() && version <= newestVersion_);
+		version = std::min(std::max(version, oldestVersion()), newestVersion_);
+		// Latest checkpoint not after the version
+		auto checkpoint = checkpoints_.upper_bound(version);
+		jassert(checkpoint != checkpoints_.begin());
+		checkpoint--;
+		Synth::PatchData result = *checkpoint->second;
+		for (uint64 v = checkpoint->first + 1; v <= version; v++) {
+			apply(entry(v), true, result);
+		}
+		return result;
+	}
+
+	std::vector<MidiMessage> Rev2EditJournal::replay(uint64 fromVersion, uint64 toVersion, MidiChannel channel) const
+	{
+		auto from = rebuild(fromVersion);
+		auto to = rebuild(toVersion);
+		std::vector<MidiMessage> result;
+		for (size_t i = 0; i < std::min(from.size(), to.size()); i++) {
+			if (from[i] != to[i]) {
+				int nrpn = Rev2ParamLayout::nrpnForSysexIndex((int)i);
+				if (nrpn != -1) {
+					auto messages = MidiHelpers::generateRPN(channel.toOneBasedInt(), nrpn, to[i], true, true, true);
+					std::copy(messages.cbegin(), messages.cend(), std::back_inserter(result));
+				}
+			}
+		}
+		return result;
+	}
+
+	Rev2EditJournal::Entry const & Rev2EditJournal::entry(uint64 version) const
+	{
+		jassert(version >= 1 && version <= newestVersion_ && newestVersion_ - version < ring_.size());
+		return ring_[(version - 1) % ring_.size()];
+	}
+
+	void Rev2EditJournal::apply(Entry const &entry, bool forward, Synth::PatchData &data) const
+	{
+		data[entry.layer * kSysexStartLayerB + entry.sysexIndex] = forward ? entry.newValue : entry.oldValue;
+	}
+
+	void Rev2EditJournal::dropCheckpointsAfter(uint64 version)
+	{
+		checkpoints_.erase(checkpoints_.upper_bound(version), checkpoints_.end());
+	}
+
+}
@@ -0,0 +1,66 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+#include "MidiChannel.h"
+
+namespace midikraft {
+
+	// Undo history for the Rev2 edit buffer. Every change of one byte is a 6 byte entry in a ring buffer, and every
+	// checkpointInterval changes a full copy of the patch is kept, so any version still in the ring can be rebuilt by
+	// applying at most checkpointInterval entries to a checkpoint.
+	// Versions count the changes recorded, version 0 is the initial patch. Not thread safe, use from one thread only.
+	class Rev2EditJournal {
+	public:
+		struct Entry {
+			uint16 sysexIndex; // Within the layer, 0 to 1023
+			uint8 layer;
+			uint8 oldValue;
+			uint8 newValue;
+		};
+
+		Rev2EditJournal(Synth::PatchData const &initialPatch, size_t capacity = 4096, size_t checkpointInterval = 256);
+
+		// Records a change of the byte at the given index of the 2048 byte patch. Changes that don't change anything are ignored.
+		// Recording after an undo discards the changes that could have been redone
+		void record(int sysexIndex, uint8 oldValue, uint8 newValue);
+		// Records all bytes that differ, e.g. when a complete edit buffer arrives
+		void recordDifferences(Synth::PatchData const &before, Synth::PatchData const &after);
+
+		Synth::PatchData const &current() const;
+		uint64 version() const;
+		uint64 newestVersion() const;
+		// The oldest version that can still be rebuilt or undone to, older entries have been overwritten
+		uint64 oldestVersion() const;
+
+		bool canUndo() const;
+		bool canRedo() const;
+		bool undo();
+		bool redo();
+		// Moves the current version, returns false if the version is not available anymore
+		bool gotoVersion(uint64 version);
+
+		Synth::PatchData rebuild(uint64 version) const;
+		// The minimal NRPN batch that turns the synth's edit buffer from one version into the other, one NRPN per changed byte.
+		// Bytes without an NRPN (e.g. the layer names) are skipped
+		std::vector<MidiMessage> replay(uint64 fromVersion, uint64 toVersion, MidiChannel channel) const;
+
+	private:
+		Entry const &entry(uint64 version) const;
+		void apply(Entry const &entry, bool forward, Synth::PatchData &data) const;
+		void dropCheckpointsAfter(uint64 version);
+
+		std::vector<Entry> ring_;
+		size_t checkpointInterval_;
+		std::map<uint64, std::shared_ptr<Synth::PatchData const>> checkpoints_;
+		Synth::PatchData current_;
+		uint64 version_;
+		uint64 newestVersion_;
+	};
+
+}
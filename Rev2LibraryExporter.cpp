@@ -0,0 +1,269 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2LibraryExporter.h"
+
+#include "Rev2.h"
+#include "Rev2Patch.h"
+#include "Rev2Trace.h"
+
+#include <algorithm>
+#include <future>
+#include <thread>
+
+namespace midikraft {
+
+	namespace {
+
+		enum ColumnType : uint8 { UINT8 = 0, UINT16 = 1, UINT32 = 2, STRING = 3 };
+
+		enum class ColumnKind { ROW, PLACE, NAME, RAW, TEXT };
+
+		struct Column {
+			std::string name;
+			ColumnType type;
+			ColumnKind kind;
+			int layer;
+			Rev2ParamDefinition const *param;
+			int sysexIndex; // For raw values
+			int textIndex; // Index into the rendered texts of a row
+		};
+
+		// Everything that is expensive to compute for one patch. Rendered in parallel, written in order
+		struct RenderedRow {
+			int place;
+			std::string name;
+			std::vector<uint8> raw;
+			std::vector<std::string> text;
+		};
+
+		std::vector<Column> buildColumns(Rev2LibraryExporter::Options const &options)
+		{
+			std::vector<Column> columns;
+			columns.push_back({ "row", UINT32, ColumnKind::ROW, 0, nullptr, -1, -1 });
+			columns.push_back({ "place", UINT16, ColumnKind::PLACE, 0, nullptr, -1, -1 });
+			columns.push_back({ "name", STRING, ColumnKind::NAME, 0, nullptr, -1, -1 });
+			int texts = 0;
+			for (int layer = 0; layer < 2; layer++) {
+				std::string prefix = layer == 0 ? "A " : "B ";
+				for (auto const &param : Rev2Patch::parameterDefinitions()) {
+					if (options.rawValues) {
+						bool isArray = param.type() == SynthParameterDefinition::ParamType::INT_ARRAY || param.type() == SynthParameterDefinition::ParamType::LOOKUP_ARRAY;
+						for (int index = param.sysexIndex(layer); index <= param.endSysexIndex(layer); index++) {
+							std::string name = prefix + param.name();
+							if (isArray) {
+								name += "[" + std::to_string(index - param.sysexIndex(layer)) + "]";
+							}
+							columns.push_back({ name, UINT8, ColumnKind::RAW, layer, &param, index, -1 });
+						}
+					}
+					if (options.text) {
+						columns.push_back({ prefix + param.name() + " (text)", STRING, ColumnKind::TEXT, layer, &param, -1, texts++ });
+					}
+				}
+			}
+			return columns;
+		}
+
+		void renderRow(std::vector<Column> const &columns, DataFile const &patch, RenderedRow &row)
+		{
+			auto rev2Patch = dynamic_cast<Rev2Patch const *>(&patch);
+			row.place = rev2Patch ? rev2Patch->patchNumber().toZeroBased() : 0;
+			row.name = patch.name();
+			row.raw.clear();
+			row.text.clear();
+			auto const &data = patch.data();
+			for (auto const &column : columns) {
+				if (column.kind == ColumnKind::RAW) {
+					row.raw.push_back(column.sysexIndex < (int)data.size() ? data[column.sysexIndex] : 0);
+				}
+				else if (column.kind == ColumnKind::TEXT) {
+					row.text.push_back(column.param->valueInPatchToText(patch, column.layer));
+				}
+			}
+		}
+
+		void writeCsvField(std::ostream &out, std::string const &text)
+		{
+			if (text.find_first_of(",\"\n\r") == std::string::npos) {
+				out << text;
+				return;
+			}
+			out << '"';
+			for (char c : text) {
+				if (c == '"') out << '"';
+				out << c;
+			}
+			out << '"';
+		}
+
+		void writeCsvHeader(std::ostream &out, std::vector<Column> const &columns)
+		{
+			for (size_t i = 0; i < columns.size(); i++) {
+				if (i > 0) out << ',';
+				writeCsvField(out, columns[i].name);
+			}
+			out << '\n';
+		}
+
+		void writeCsvRows(std::ostream &out, std::vector<Column> const &columns, std::vector<RenderedRow> const &rows, size_t count, size_t firstRow)
+		{
+			for (size_t r = 0; r < count; r++) {
+				auto const &row = rows[r];
+				size_t raw = 0;
+				size_t text = 0;
+				for (size_t i = 0; i < columns.size(); i++) {
+					if (i > 0) out << ',';
+					switch (columns[i].kind) {
+					case ColumnKind::ROW: out << (firstRow + r); break;
+					case ColumnKind::PLACE: out << row.place; break;
+					case ColumnKind::NAME: writeCsvField(out, row.name); break;
+					case ColumnKind::RAW: out << (int)row.raw[raw++]; break;
+					case ColumnKind::TEXT: writeCsvField(out, row.text[text++]); break;
+					}
+				}
+				out << '\n';
+			}
+		}
+
+		template<typename T>
+		void writeLittleEndian(std::ostream &out, T value)
+		{
+			for (size_t i = 0; i < sizeof(T); i++) {
+				out.put((char)((value >> (8 * i)) & 0xff));
+			}
+		}
+
+		void writeBinaryHeader(std::ostream &out, std::vector<Column> const &columns)
+		{
+			out.write("R2EX", 4);
+			writeLittleEndian<uint8>(out, 1);
+			writeLittleEndian<uint32>(out, (uint32)columns.size());
+			for (auto const &column : columns) {
+				writeLittleEndian<uint8>(out, column.type);
+				writeLittleEndian<uint16>(out, (uint16)column.name.size());
+				out.write(column.name.data(), (std::streamsize)column.name.size());
+			}
+		}
+
+		void writeStrings(std::ostream &out, std::vector<RenderedRow> const &rows, size_t count, std::function<std::string const &(RenderedRow const &)> get)
+		{
+			for (size_t r = 0; r < count; r++) {
+				writeLittleEndian<uint16>(out, (uint16)std::min(get(rows[r]).size(), (size_t)0xffff));
+			}
+			for (size_t r = 0; r < count; r++) {
+				auto const &text = get(rows[r]);
+				out.write(text.data(), (std::streamsize)std::min(text.size(), (size_t)0xffff));
+			}
+		}
+
+		void writeBinaryRowGroup(std::ostream &out, std::vector<Column> const &columns, std::vector<RenderedRow> const &rows, size_t count, size_t firstRow)
+		{
+			writeLittleEndian<uint32>(out, (uint32)count);
+			size_t raw = 0;
+			size_t text = 0;
+			std::vector<char> bytes(count);
+			for (auto const &column : columns) {
+				switch (column.kind) {
+				case ColumnKind::ROW:
+					for (size_t r = 0; r < count; r++) writeLittleEndian<uint32>(out, (uint32)(firstRow + r));
+					break;
+				case ColumnKind::PLACE:
+					for (size_t r = 0; r < count; r++) writeLittleEndian<uint16>(out, (uint16)rows[r].place);
+					break;
+				case ColumnKind::NAME:
+					writeStrings(out, rows, count, [](RenderedRow const &row) -> std::string const & { return row.name; });
+					break;
+				case ColumnKind::RAW:
+					for (size_t r = 0; r < count; r++) bytes[r] = (char)rows[r].raw[raw];
+					out.write(bytes.data(), (std::streamsize)count);
+					raw++;
+					break;
+				case ColumnKind::TEXT: {
+					size_t index = text++;
+					writeStrings(out, rows, count, [index](RenderedRow const &row) -> std::string const & { return row.text[index]; });
+					break;
+				}
+				}
+			}
+		}
+
+	}
+
+	Rev2LibraryExporter::Result Rev2LibraryExporter::exportLibrary(PatchSource const &source, std::ostream &out, Options const &options)
+	{
+		Rev2TraceSpan span("exportLibrary");
+		Result result;
+		auto columns = buildColumns(options);
+		result.columns = columns.size();
+		size_t chunkSize = std::max((size_t)1, options.chunkSize);
+		int threads = options.threads > 0 ? options.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+		if (options.format == Format::CSV) {
+			writeCsvHeader(out, columns);
+		}
+		else {
+			writeBinaryHeader(out, columns);
+		}
+
+		// The buffers are reused for every chunk, so memory stays the same however large the library is
+		std::vector<std::shared_ptr<DataFile>> chunk;
+		std::vector<RenderedRow> rows(chunkSize);
+		bool sourceEmpty = false;
+		while (!sourceEmpty) {
+			chunk.clear();
+			while (chunk.size() < chunkSize) {
+				auto patch = source();
+				if (!patch) {
+					sourceEmpty = true;
+					break;
+				}
+				if (patch->dataTypeID() != Rev2::PATCH) {
+					result.skipped++;
+					continue;
+				}
+				chunk.push_back(patch);
+			}
+			if (chunk.empty()) break;
+
+			// Each thread renders a contiguous part of the chunk into its own rows, so the order is kept without any locking
+			size_t perThread = (chunk.size() + threads - 1) / threads;
+			std::vector<std::future<void>> running;
+			for (size_t start = 0; start < chunk.size(); start += perThread) {
+				size_t end = std::min(chunk.size(), start + perThread);
+				running.push_back(std::async(std::launch::async, [&columns, &chunk, &rows, start, end]() {
+					for (size_t i = start; i < end; i++) {
+						renderRow(columns, *chunk[i], rows[i]);
+					}
+				}));
+			}
+			for (auto &future : running) {
+				future.get();
+			}
+
+			if (options.format == Format::CSV) {
+				writeCsvRows(out, columns, rows, chunk.size(), result.patchesExported);
+			}
+			else {
+				writeBinaryRowGroup(out, columns, rows, chunk.size(), result.patchesExported);
+			}
+			result.patchesExported += chunk.size();
+		}
+
+		if (options.format == Format::BINARY) {
+			writeLittleEndian<uint32>(out, 0);
+		}
+		out.flush();
+		return result;
+	}
+
+	Rev2LibraryExporter::Result Rev2LibraryExporter::exportLibrary(std::vector<std::shared_ptr<DataFile>> const &patches, std::ostream &out, Options const &options)
+	{
+		size_t next = 0;
+		return exportLibrary([&patches, &next]() { return next < patches.size() ? patches[next++] : nullptr; }, out, options);
+	}
+
+}
@@ -0,0 +1,57 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+
+#include <functional>
+#include <ostream>
+
+namespace midikraft {
+
+	class Rev2ParamDefinition;
+
+	// Writes all parameters of all patches of a library as one table, for analysis outside of the librarian.
+	// The patches are pulled from a source in chunks, so memory use does not grow with the library. Each chunk is rendered
+	// by several threads, and written in the order the patches came from the source.
+	//
+	// Columns are "row", "place" and "name", then for each layer the parameters in the order of Rev2Patch::parameterDefinitions().
+	// Raw values get one column per sysex byte, e.g. "A Seq Track 1[3]", rendered text one column per parameter, e.g. "A Seq Track 1 (text)".
+	//
+	// The binary format is little endian:
+	//   "R2EX", uint8 version 1, uint32 number of columns, and per column uint8 type (0 = uint8, 1 = uint16, 2 = uint32, 3 = string),
+	//   uint16 name length and the name.
+	//   Then row groups of uint32 number of rows, followed by each column's values for these rows: the numbers back to back,
+	//   strings as all uint16 lengths followed by all bytes. A row group of 0 rows ends the file.
+	class Rev2LibraryExporter {
+	public:
+		enum class Format { CSV, BINARY };
+
+		struct Options {
+			Format format = Format::CSV;
+			bool rawValues = true;
+			bool text = false;
+			size_t chunkSize = 256; // Patches per row group
+			int threads = 0; // 0 means one per hardware thread
+		};
+
+		// Returns the next patch of the library, or nullptr at the end
+		typedef std::function<std::shared_ptr<DataFile>()> PatchSource;
+
+		struct Result {
+			size_t patchesExported = 0;
+			size_t skipped = 0; // Data files that are not Rev2 patches
+			size_t columns = 0;
+		};
+
+		static Result exportLibrary(PatchSource const &source, std::ostream &out, Options const &options);
+
+		// Convenience for a library that is in memory already
+		static Result exportLibrary(std::vector<std::shared_ptr<DataFile>> const &patches, std::ostream &out, Options const &options);
+	};
+
+}
@@ -0,0 +1,237 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2Metrics.h"
+
+#include <sstream>
+
+namespace midikraft {
+
+	Rev2Metrics::Histogram::Histogram()
+	{
+		reset();
+	}
+
+	void Rev2Metrics::Histogram::record(uint64 microseconds)
+	{
+		int bucket = 0;
+		while (bucket < kNumberOfBuckets - 1 && (microseconds >> bucket) != 0) {
+			bucket++;
+		}
+		buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_.fetch_add(microseconds, std::memory_order_relaxed);
+		uint64 previousMax = max_.load(std::memory_order_relaxed);
+		while (microseconds > previousMax && !max_.compare_exchange_weak(previousMax, microseconds, std::memory_order_relaxed)) {
+			// previousMax has been updated by compare_exchange_weak, retry
+		}
+	}
+
+	Rev2Metrics::Histogram::Snapshot Rev2Metrics::Histogram::snapshot() const
+	{
+		Snapshot result;
+		for (int i = 0; i < kNumberOfBuckets; i++) {
+			result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+		}
+		result.count = count_.load(std::memory_order_relaxed);
+		result.sumMicroseconds = sum_.load(std::memory_order_relaxed);
+		result.maxMicroseconds = max_.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	void Rev2Metrics::Histogram::reset()
+	{
+		for (auto &bucket : buckets_) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		count_.store(0, std::memory_order_relaxed);
+		sum_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	double Rev2Metrics::Histogram::Snapshot::meanMicroseconds() const
+	{
+		return count > 0 ? sumMicroseconds / (double)count : 0.0;
+	}
+
+	uint64 Rev2Metrics::Histogram::Snapshot::percentileMicroseconds(double percentile) const
+	{
+		uint64 rank = (uint64)(percentile * count);
+		uint64 seen = 0;
+		for (int i = 0; i < kNumberOfBuckets; i++) {
+			seen += buckets[i];
+			if (seen > rank) {
+				return std::min(((uint64)1) << i, maxMicroseconds);
+			}
+		}
+		return maxMicroseconds;
+	}
+
+	Rev2Metrics::ScopedTimer::ScopedTimer(Histogram &histogram) : histogram_(histogram), startTicks_(Time::getHighResolutionTicks())
+	{
+	}
+
+	Rev2Metrics::ScopedTimer::~ScopedTimer()
+	{
+		histogram_.record(ticksToMicroseconds(Time::getHighResolutionTicks() - startTicks_));
+	}
+
+	Rev2Metrics::Rev2Metrics()
+	{
+		reset();
+	}
+
+	void Rev2Metrics::countIncoming(MessageType type, size_t sysexBytes)
+	{
+		messagesIn_[type].fetch_add(1, std::memory_order_relaxed);
+		sysexBytesIn_.fetch_add(sysexBytes, std::memory_order_relaxed);
+	}
+
+	void Rev2Metrics::countOutgoing(MessageType type, size_t sysexBytes, size_t numberOfMessages /* = 1 */)
+	{
+		messagesOut_[type].fetch_add(numberOfMessages, std::memory_order_relaxed);
+		sysexBytesOut_.fetch_add(sysexBytes, std::memory_order_relaxed);
+	}
+
+	void Rev2Metrics::countGeneratedNRPNs(size_t numberOfNRPNs)
+	{
+		nrpnsGenerated_.fetch_add(numberOfNRPNs, std::memory_order_relaxed);
+	}
+
+	Rev2Metrics::Histogram & Rev2Metrics::decodeTime()
+	{
+		return decodeTime_;
+	}
+
+	Rev2Metrics::Histogram & Rev2Metrics::encodeTime()
+	{
+		return encodeTime_;
+	}
+
+	void Rev2Metrics::editBufferRequested()
+	{
+		editBufferRequestTicks_.store(Time::getHighResolutionTicks(), std::memory_order_relaxed);
+	}
+
+	void Rev2Metrics::editBufferReceived()
+	{
+		int64 requestTicks = editBufferRequestTicks_.exchange(0, std::memory_order_relaxed);
+		if (requestTicks != 0) {
+			editBufferReplyLatency_.record(ticksToMicroseconds(Time::getHighResolutionTicks() - requestTicks));
+		}
+	}
+
+	void Rev2Metrics::programRequested(int programNumber)
+	{
+		if (programNumber >= 0 && programNumber < (int)programRequestTicks_.size()) {
+			programRequestTicks_[programNumber].store(Time::getHighResolutionTicks(), std::memory_order_relaxed);
+		}
+	}
+
+	void Rev2Metrics::programReceived(int programNumber)
+	{
+		if (programNumber >= 0 && programNumber < (int)programRequestTicks_.size()) {
+			int64 requestTicks = programRequestTicks_[programNumber].exchange(0, std::memory_order_relaxed);
+			if (requestTicks != 0) {
+				programReplyLatency_.record(ticksToMicroseconds(Time::getHighResolutionTicks() - requestTicks));
+			}
+		}
+	}
+
+	Rev2Metrics::Snapshot Rev2Metrics::snapshot() const
+	{
+		Snapshot result;
+		result.sysexBytesIn = sysexBytesIn_.load(std::memory_order_relaxed);
+		result.sysexBytesOut = sysexBytesOut_.load(std::memory_order_relaxed);
+		for (int i = 0; i < NUMBER_OF_MESSAGE_TYPES; i++) {
+			result.messagesIn[i] = messagesIn_[i].load(std::memory_order_relaxed);
+			result.messagesOut[i] = messagesOut_[i].load(std::memory_order_relaxed);
+		}
+		result.nrpnsGenerated = nrpnsGenerated_.load(std::memory_order_relaxed);
+		result.decodeTime = decodeTime_.snapshot();
+		result.encodeTime = encodeTime_.snapshot();
+		result.editBufferReplyLatency = editBufferReplyLatency_.snapshot();
+		result.programReplyLatency = programReplyLatency_.snapshot();
+		return result;
+	}
+
+	static void histogramToJson(std::ostream &out, std::string const &name, Rev2Metrics::Histogram::Snapshot const &histogram)
+	{
+		out << "\"" << name << "\": { \"count\": " << histogram.count
+			<< ", \"mean_us\": " << histogram.meanMicroseconds()
+			<< ", \"p50_us\": " << histogram.percentileMicroseconds(0.5)
+			<< ", \"p99_us\": " << histogram.percentileMicroseconds(0.99)
+			<< ", \"max_us\": " << histogram.maxMicroseconds
+			<< ", \"buckets\": [";
+		for (int i = 0; i < Rev2Metrics::Histogram::kNumberOfBuckets; i++) {
+			out << histogram.buckets[i] << (i + 1 < Rev2Metrics::Histogram::kNumberOfBuckets ? ", " : "");
+		}
+		out << "] }";
+	}
+
+	std::string Rev2Metrics::toJson() const
+	{
+		auto s = snapshot();
+		std::stringstream out;
+		out << "{ \"sysex_bytes_in\": " << s.sysexBytesIn << ", \"sysex_bytes_out\": " << s.sysexBytesOut;
+		out << ", \"messages_in\": {";
+		for (int i = 0; i < NUMBER_OF_MESSAGE_TYPES; i++) {
+			out << " \"" << messageTypeName(MessageType(i)) << "\": " << s.messagesIn[i] << (i + 1 < NUMBER_OF_MESSAGE_TYPES ? "," : " ");
+		}
+		out << "}, \"messages_out\": {";
+		for (int i = 0; i < NUMBER_OF_MESSAGE_TYPES; i++) {
+			out << " \"" << messageTypeName(MessageType(i)) << "\": " << s.messagesOut[i] << (i + 1 < NUMBER_OF_MESSAGE_TYPES ? "," : " ");
+		}
+		out << "}, \"nrpns_generated\": " << s.nrpnsGenerated << ", ";
+		histogramToJson(out, "decode_time", s.decodeTime);
+		out << ", ";
+		histogramToJson(out, "encode_time", s.encodeTime);
+		out << ", ";
+		histogramToJson(out, "edit_buffer_reply_latency", s.editBufferReplyLatency);
+		out << ", ";
+		histogramToJson(out, "program_reply_latency", s.programReplyLatency);
+		out << " }";
+		return out.str();
+	}
+
+	void Rev2Metrics::reset()
+	{
+		sysexBytesIn_.store(0, std::memory_order_relaxed);
+		sysexBytesOut_.store(0, std::memory_order_relaxed);
+		for (int i = 0; i < NUMBER_OF_MESSAGE_TYPES; i++) {
+			messagesIn_[i].store(0, std::memory_order_relaxed);
+			messagesOut_[i].store(0, std::memory_order_relaxed);
+		}
+		nrpnsGenerated_.store(0, std::memory_order_relaxed);
+		decodeTime_.reset();
+		encodeTime_.reset();
+		editBufferReplyLatency_.reset();
+		programReplyLatency_.reset();
+		editBufferRequestTicks_.store(0, std::memory_order_relaxed);
+		for (auto &ticks : programRequestTicks_) {
+			ticks.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	std::string Rev2Metrics::messageTypeName(MessageType type)
+	{
+		switch (type) {
+		case EDIT_BUFFER: return "edit_buffer";
+		case PROGRAM_DUMP: return "program_dump";
+		case NRPN: return "nrpn";
+		case TUNING: return "tuning";
+		case GLOBAL_SETTINGS: return "global_settings";
+		case OTHER: return "other";
+		default: return "invalid";
+		}
+	}
+
+	uint64 Rev2Metrics::ticksToMicroseconds(int64 ticks)
+	{
+		return ticks > 0 ? (uint64)(ticks * 1000000 / Time::getHighResolutionTicksPerSecond()) : 0;
+	}
+
+}
@@ -0,0 +1,119 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+
+namespace midikraft {
+
+	// Counters and latency histograms for the MIDI traffic of one Rev2. All recording functions are lock free and
+	// cheap enough to be called from the MIDI thread, the host application can poll snapshot() or toJson() at any time.
+	class Rev2Metrics {
+	public:
+		enum MessageType {
+			EDIT_BUFFER = 0,
+			PROGRAM_DUMP,
+			NRPN,
+			TUNING,
+			GLOBAL_SETTINGS,
+			OTHER,
+			NUMBER_OF_MESSAGE_TYPES
+		};
+
+		// Histogram with power of two buckets in microseconds, bucket i counts values in [2^(i-1), 2^i)
+		class Histogram {
+		public:
+			static const int kNumberOfBuckets = 32;
+
+			struct Snapshot {
+				uint64 count = 0;
+				uint64 sumMicroseconds = 0;
+				uint64 maxMicroseconds = 0;
+				std::array<uint64, kNumberOfBuckets> buckets = {};
+
+				double meanMicroseconds() const;
+				// Upper bound of the bucket containing the given percentile (0.0 to 1.0)
+				uint64 percentileMicroseconds(double percentile) const;
+			};
+
+			Histogram();
+
+			void record(uint64 microseconds);
+			Snapshot snapshot() const;
+			void reset();
+
+		private:
+			std::array<std::atomic<uint64>, kNumberOfBuckets> buckets_;
+			std::atomic<uint64> count_;
+			std::atomic<uint64> sum_;
+			std::atomic<uint64> max_;
+		};
+
+		// Measures the lifetime of the object into the histogram given
+		class ScopedTimer {
+		public:
+			ScopedTimer(Histogram &histogram);
+			~ScopedTimer();
+
+		private:
+			Histogram &histogram_;
+			int64 startTicks_;
+		};
+
+		struct Snapshot {
+			uint64 sysexBytesIn = 0;
+			uint64 sysexBytesOut = 0;
+			std::array<uint64, NUMBER_OF_MESSAGE_TYPES> messagesIn = {};
+			std::array<uint64, NUMBER_OF_MESSAGE_TYPES> messagesOut = {};
+			uint64 nrpnsGenerated = 0;
+			Histogram::Snapshot decodeTime;
+			Histogram::Snapshot encodeTime;
+			Histogram::Snapshot editBufferReplyLatency;
+			Histogram::Snapshot programReplyLatency;
+		};
+
+		Rev2Metrics();
+
+		void countIncoming(MessageType type, size_t sysexBytes);
+		void countOutgoing(MessageType type, size_t sysexBytes, size_t numberOfMessages = 1);
+		void countGeneratedNRPNs(size_t numberOfNRPNs);
+
+		Histogram &decodeTime();
+		Histogram &encodeTime();
+
+		// Request to reply latency tracking. Only the latest outstanding request per item is tracked
+		void editBufferRequested();
+		void editBufferReceived();
+		void programRequested(int programNumber);
+		void programReceived(int programNumber);
+
+		Snapshot snapshot() const;
+		std::string toJson() const;
+		void reset();
+
+		static std::string messageTypeName(MessageType type);
+
+	private:
+		static uint64 ticksToMicroseconds(int64 ticks);
+
+		std::atomic<uint64> sysexBytesIn_;
+		std::atomic<uint64> sysexBytesOut_;
+		std::array<std::atomic<uint64>, NUMBER_OF_MESSAGE_TYPES> messagesIn_;
+		std::array<std::atomic<uint64>, NUMBER_OF_MESSAGE_TYPES> messagesOut_;
+		std::atomic<uint64> nrpnsGenerated_;
+		Histogram decodeTime_;
+		Histogram encodeTime_;
+		Histogram editBufferReplyLatency_;
+		Histogram programReplyLatency_;
+		std::atomic<int64> editBufferRequestTicks_; // 0 means no request outstanding
+		std::array<std::atomic<int64>, 1024> programRequestTicks_;
+	};
+
+}
@@ -0,0 +1,175 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2MorphEngine.h"
+
+#include "Rev2Patch.h"
+#include "Rev2ParamLayout.h"
+#include "Rev2NrpnTemplates.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace midikraft {
+
+	Rev2MorphEngine::Rev2MorphEngine(std::shared_ptr<Rev2> synth) : synth_(synth), startTime_(0.0), durationMs_(0.0), lookupThreshold_(0.5), position_(0.0),
+		tickMs_(kDefaultTickMs), bytesPerSecond_(kDefaultBytesPerSecond), budget_(0.0), lastTickTime_(0.0), running_(false)
+	{
+	}
+
+	Rev2MorphEngine::~Rev2MorphEngine()
+	{
+		stopTimer();
+	}
+
+	void Rev2MorphEngine::setBandwidthBudget(int bytesPerSecond)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		// Less than one NRPN per second still finishes, but hardly morphs
+		jassert(bytesPerSecond >= (int)Rev2NrpnTemplates::kBytesPerNRPN);
+		bytesPerSecond_ = std::max(1, bytesPerSecond);
+	}
+
+	void Rev2MorphEngine::setTickInterval(int milliseconds)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		tickMs_ = std::max(1, milliseconds);
+	}
+
+	void Rev2MorphEngine::start(std::shared_ptr<DataFile> from, std::shared_ptr<DataFile> to, double seconds, double lookupThreshold /* = 0.5 */)
+	{
+		stop();
+		if (!from || !to) {
+			jassertfalse;
+			return;
+		}
+		int tickMs;
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			tracks_.clear();
+			for (int layer = 0; layer < 2; layer++) {
+				for (auto const &param : Rev2Patch::parameterDefinitions()) {
+					// The sequencer arrays (and the layer names) are not morphed
+					if (param.type() == SynthParameterDefinition::ParamType::INT_ARRAY || param.type() == SynthParameterDefinition::ParamType::LOOKUP_ARRAY) {
+						continue;
+					}
+					int fromValue, toValue;
+					if (!param.valueInPatch(*from, layer, fromValue) || !param.valueInPatch(*to, layer, toValue) || fromValue == toValue) {
+						continue;
+					}
+					// Note names are displayed as lookup, but they are as continuous as any other value
+					auto descriptor = Rev2ParamLayout::findByNRPN(param.nrpn(0));
+					bool interpolate = param.type() == SynthParameterDefinition::ParamType::INT || (descriptor && descriptor->lookup == Rev2ValueLookup::NOTE_NAME);
+					tracks_.push_back({ param.nrpn(layer), fromValue, toValue, interpolate, fromValue, 0 });
+				}
+			}
+			startTime_ = Time::getMillisecondCounterHiRes();
+			lastTickTime_ = startTime_;
+			durationMs_ = std::max(0.0, seconds * 1000.0);
+			lookupThreshold_ = lookupThreshold;
+			position_ = 0.0;
+			budget_ = 0.0;
+			statistics_ = Statistics();
+			running_ = true;
+			tickMs = tickMs_;
+		}
+		startTimer(tickMs);
+	}
+
+	void Rev2MorphEngine::stop()
+	{
+		// Not under the lock, stopping waits for a running callback to finish
+		stopTimer();
+		std::lock_guard<std::mutex> lock(lock_);
+		running_ = false;
+	}
+
+	bool Rev2MorphEngine::isRunning() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return running_;
+	}
+
+	double Rev2MorphEngine::position() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return position_;
+	}
+
+	Rev2MorphEngine::Statistics Rev2MorphEngine::statistics() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return statistics_;
+	}
+
+	int Rev2MorphEngine::valueAt(Track const &track, double position) const
+	{
+		if (track.interpolate) {
+			return (int)std::lround(track.fromValue + (track.toValue - track.fromValue) * position);
+		}
+		return position >= lookupThreshold_ ? track.toValue : track.fromValue;
+	}
+
+	void Rev2MorphEngine::hiResTimerCallback()
+	{
+		std::vector<MidiMessage> messages;
+		bool finished = false;
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			if (!running_) return;
+			double now = Time::getMillisecondCounterHiRes();
+			statistics_.ticks++;
+			position_ = durationMs_ > 0.0 ? std::min(1.0, (now - startTime_) / durationMs_) : 1.0;
+
+			// Refill the budget for the time passed, but don't let it pile up while there was nothing to send. The cap must hold
+			// at least the largest single message, else short ticks or small budgets never send anything and the morph never ends
+			double maxBudget = std::max(2.0 * tickMs_ * bytesPerSecond_ / 1000.0, (double)Rev2NrpnTemplates::kBytesPerNRPN);
+			budget_ = std::min(budget_ + (now - lastTickTime_) * bytesPerSecond_ / 1000.0, maxBudget);
+			lastTickTime_ = now;
+
+			// Collect what changed, longest waiting first so no parameter starves
+			std::vector<Track *> changed;
+			for (auto &track : tracks_) {
+				if (valueAt(track, position_) != track.lastSent) {
+					if (track.pendingSinceTick == 0) track.pendingSinceTick = statistics_.ticks;
+					changed.push_back(&track);
+				}
+			}
+			std::stable_sort(changed.begin(), changed.end(), [](Track const *a, Track const *b) { return a->pendingSinceTick < b->pendingSinceTick; });
+
+			for (auto track : changed) {
+				int value = valueAt(*track, position_);
+				auto valueMessages = synth_->parameterChangeMessages(track->nrpn, value);
+				size_t bytes = 0;
+				for (auto const &message : valueMessages) bytes += (size_t)message.getRawDataSize();
+				if (bytes > budget_) {
+					statistics_.valuesDeferred++;
+					continue;
+				}
+				budget_ -= bytes;
+				std::copy(valueMessages.begin(), valueMessages.end(), std::back_inserter(messages));
+				track->lastSent = value;
+				track->pendingSinceTick = 0;
+				statistics_.valuesSent++;
+				statistics_.bytesSent += bytes;
+			}
+
+			// Done when the end is reached and every parameter has arrived at its target
+			finished = position_ >= 1.0 && std::all_of(tracks_.begin(), tracks_.end(), [](Track const &track) { return track.lastSent == track.toValue; });
+			if (finished) {
+				running_ = false;
+			}
+		}
+		if (!messages.empty()) {
+			synth_->sendToSynth(messages);
+		}
+		if (finished) {
+			// Stopping from within the callback is allowed for the HighResolutionTimer
+			stopTimer();
+		}
+	}
+
+}
@@ -0,0 +1,77 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Rev2.h"
+
+#include <mutex>
+
+namespace midikraft {
+
+	// Morphs the edit buffer of the Rev2 from one patch to another over a given time, for live performance.
+	// Continuous parameters are interpolated, parameters with named values switch over at a threshold, and the sequencer
+	// arrays are not touched. Every tick of a high resolution timer sends only the values that changed since the last tick,
+	// and never more bytes than the bandwidth budget allows, so notes played at the same time still get through.
+	// Values that don't fit into a tick are sent in the next ticks, starting with those that waited longest.
+	class Rev2MorphEngine : private HighResolutionTimer {
+	public:
+		static const int kDefaultTickMs = 10;
+		// DIN MIDI transfers 3125 bytes per second, leave a third of it for the notes
+		static const int kDefaultBytesPerSecond = 2000;
+
+		struct Statistics {
+			uint64 ticks = 0;
+			uint64 valuesSent = 0;
+			uint64 bytesSent = 0;
+			uint64 valuesDeferred = 0; // Values that had to wait for a later tick because of the budget
+		};
+
+		Rev2MorphEngine(std::shared_ptr<Rev2> synth);
+		virtual ~Rev2MorphEngine();
+
+		// Any budget makes progress, a tick can always save up for one NRPN
+		void setBandwidthBudget(int bytesPerSecond);
+		void setTickInterval(int milliseconds);
+
+		// The edit buffer of the synth is expected to hold the from patch already. lookupThreshold is the position at which
+		// parameters with named values, e.g. the oscillator shapes, switch from the from value to the to value
+		void start(std::shared_ptr<DataFile> from, std::shared_ptr<DataFile> to, double seconds, double lookupThreshold = 0.5);
+		void stop();
+		bool isRunning() const;
+		// 0.0 at the start to 1.0 at the end of the morph
+		double position() const;
+		Statistics statistics() const;
+
+	private:
+		struct Track {
+			int nrpn;
+			int fromValue;
+			int toValue;
+			bool interpolate;
+			int lastSent;
+			uint64 pendingSinceTick; // 0 while nothing is pending
+		};
+
+		virtual void hiResTimerCallback() override;
+		int valueAt(Track const &track, double position) const;
+
+		std::shared_ptr<Rev2> synth_;
+		mutable std::mutex lock_;
+		std::vector<Track> tracks_;
+		double startTime_;
+		double durationMs_;
+		double lookupThreshold_;
+		double position_;
+		int tickMs_;
+		int bytesPerSecond_;
+		double budget_; // Bytes we may send right now
+		double lastTickTime_;
+		bool running_;
+		Statistics statistics_;
+	};
+
+}
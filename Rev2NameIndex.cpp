@@ -0,0 +1,203 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2NameIndex.h"
+
+#include <algorithm>
+
+namespace midikraft {
+
+	// Layer A name starts at 235, Layer B name starts at 1259
+	const size_t kLayerNameOffsets[2] = { 235, 1259 };
+
+	static char foldCase(uint8 c)
+	{
+		return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : (char)c;
+	}
+
+	static uint32 trigram(const char *text)
+	{
+		return ((uint32)(uint8)text[0] << 16) | ((uint32)(uint8)text[1] << 8) | (uint32)(uint8)text[2];
+	}
+
+	void Rev2NameIndex::update(PatchID id, Synth::PatchData const &patchData)
+	{
+		jassert(patchData.size() >= kLayerNameOffsets[1] + kNameLength);
+		uint32 slot = slotFor(id);
+		removeTrigrams(slot);
+		for (int layer = 0; layer < 2; layer++) {
+			setName(slot, layer, reinterpret_cast<const char *>(&patchData[kLayerNameOffsets[layer]]), kNameLength);
+		}
+		addTrigrams(slot);
+	}
+
+	void Rev2NameIndex::updateLayerName(PatchID id, int layerNo, std::string const &layerName)
+	{
+		jassert(layerNo == 0 || layerNo == 1);
+		uint32 slot = slotFor(id);
+		removeTrigrams(slot);
+		setName(slot, layerNo, layerName.data(), layerName.size());
+		addTrigrams(slot);
+	}
+
+	void Rev2NameIndex::remove(PatchID id)
+	{
+		auto found = slotById_.find(id);
+		if (found == slotById_.end()) return;
+		removeTrigrams(found->second);
+		entries_[found->second].used = false;
+		freeSlots_.push_back(found->second);
+		slotById_.erase(found);
+	}
+
+	void Rev2NameIndex::clear()
+	{
+		entries_.clear();
+		freeSlots_.clear();
+		slotById_.clear();
+		postings_.clear();
+	}
+
+	size_t Rev2NameIndex::size() const
+	{
+		return slotById_.size();
+	}
+
+	std::vector<Rev2NameIndex::PatchID> Rev2NameIndex::findSubstring(std::string const &query) const
+	{
+		return find(query, false);
+	}
+
+	std::vector<Rev2NameIndex::PatchID> Rev2NameIndex::findPrefix(std::string const &query) const
+	{
+		return find(query, true);
+	}
+
+	uint32 Rev2NameIndex::slotFor(PatchID id)
+	{
+		auto found = slotById_.find(id);
+		if (found != slotById_.end()) {
+			return found->second;
+		}
+		uint32 slot;
+		if (!freeSlots_.empty()) {
+			slot = freeSlots_.back();
+			freeSlots_.pop_back();
+		}
+		else {
+			slot = (uint32)entries_.size();
+			entries_.emplace_back();
+		}
+		Entry &entry = entries_[slot];
+		entry.id = id;
+		entry.used = true;
+		std::fill(&entry.names[0][0], &entry.names[0][0] + 2 * kNameLength, ' ');
+		slotById_[id] = slot;
+		return slot;
+	}
+
+	void Rev2NameIndex::setName(uint32 slot, int layerNo, const char *name, size_t length)
+	{
+		// Same as Rev2Patch::setLayerName - the name is padded with spaces to 20 characters
+		for (int i = 0; i < kNameLength; i++) {
+			entries_[slot].names[layerNo][i] = i < (int)length ? foldCase((uint8)name[i]) : ' ';
+		}
+	}
+
+	std::vector<uint32> Rev2NameIndex::trigramsOf(uint32 slot) const
+	{
+		std::vector<uint32> result;
+		for (int layer = 0; layer < 2; layer++) {
+			for (int i = 0; i + 3 <= kNameLength; i++) {
+				result.push_back(trigram(&entries_[slot].names[layer][i]));
+			}
+		}
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+
+	void Rev2NameIndex::addTrigrams(uint32 slot)
+	{
+		for (auto t : trigramsOf(slot)) {
+			auto &list = postings_[t];
+			// Posting lists are kept sorted, so queries can intersect them with a merge
+			list.insert(std::lower_bound(list.begin(), list.end(), slot), slot);
+		}
+	}
+
+	void Rev2NameIndex::removeTrigrams(uint32 slot)
+	{
+		for (auto t : trigramsOf(slot)) {
+			auto found = postings_.find(t);
+			if (found == postings_.end()) continue;
+			auto &list = found->second;
+			auto position = std::lower_bound(list.begin(), list.end(), slot);
+			if (position != list.end() && *position == slot) {
+				list.erase(position);
+			}
+			if (list.empty()) {
+				postings_.erase(found);
+			}
+		}
+	}
+
+	std::vector<Rev2NameIndex::PatchID> Rev2NameIndex::find(std::string const &query, bool prefixOnly) const
+	{
+		std::string folded;
+		for (auto c : query) {
+			folded.push_back(foldCase((uint8)c));
+		}
+		std::vector<PatchID> result;
+		if (folded.size() > (size_t)kNameLength) {
+			return result;
+		}
+
+		auto matches = [&folded, prefixOnly](const char *name) {
+			if (prefixOnly) {
+				return std::equal(folded.begin(), folded.end(), name);
+			}
+			return std::search(name, name + kNameLength, folded.begin(), folded.end()) != name + kNameLength;
+		};
+		auto verify = [&](uint32 slot) {
+			Entry const &entry = entries_[slot];
+			if (entry.used && (matches(entry.names[0]) || matches(entry.names[1]))) {
+				result.push_back(entry.id);
+			}
+		};
+
+		if (folded.size() < 3) {
+			for (uint32 slot = 0; slot < (uint32)entries_.size(); slot++) {
+				verify(slot);
+			}
+			return result;
+		}
+
+		// Intersect the posting lists, starting with the shortest
+		std::vector<PostingList const *> lists;
+		for (size_t i = 0; i + 3 <= folded.size(); i++) {
+			auto found = postings_.find(trigram(&folded[i]));
+			if (found == postings_.end()) {
+				return result;
+			}
+			lists.push_back(&found->second);
+		}
+		std::sort(lists.begin(), lists.end(), [](PostingList const *a, PostingList const *b) { return a->size() < b->size(); });
+		std::vector<uint32> candidates = *lists[0];
+		std::vector<uint32> intersection;
+		for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+			intersection.clear();
+			std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(intersection));
+			candidates.swap(intersection);
+		}
+		// Having all trigrams doesn't mean they are in the right order and in the same layer name
+		for (auto slot : candidates) {
+			verify(slot);
+		}
+		return result;
+	}
+
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+
+#include <unordered_map>
+
+namespace midikraft {
+
+	// Trigram index over the two 20 character layer names of Rev2 patches, for searching large libraries by name.
+	// Matching ignores case. A substring query looks up the posting lists of its trigrams and only verifies the patches
+	// in their intersection, queries shorter than three characters scan the stored names.
+	// The patches are identified by an id chosen by the caller. Not thread safe.
+	class Rev2NameIndex {
+	public:
+		typedef uint64 PatchID;
+
+		// Adds or replaces the names of the patch
+		void update(PatchID id, Synth::PatchData const &patchData);
+		// Call this after Rev2Patch::setLayerName()
+		void updateLayerName(PatchID id, int layerNo, std::string const &layerName);
+		void remove(PatchID id);
+		void clear();
+		size_t size() const;
+
+		// Patches where one of the layer names contains the query
+		std::vector<PatchID> findSubstring(std::string const &query) const;
+		// Patches where one of the layer names starts with the query
+		std::vector<PatchID> findPrefix(std::string const &query) const;
+
+	private:
+		static const int kNameLength = 20;
+
+		struct Entry {
+			PatchID id;
+			bool used;
+			char names[2][kNameLength];
+		};
+
+		typedef std::vector<uint32> PostingList;
+
+		uint32 slotFor(PatchID id);
+		void setName(uint32 slot, int layerNo, const char *name, size_t length);
+		void addTrigrams(uint32 slot);
+		void removeTrigrams(uint32 slot);
+		std::vector<uint32> trigramsOf(uint32 slot) const;
+		std::vector<PatchID> find(std::string const &query, bool prefixOnly) const;
+
+		std::vector<Entry> entries_;
+		std::vector<uint32> freeSlots_;
+		std::unordered_map<PatchID, uint32> slotById_;
+		std::unordered_map<uint32, PostingList> postings_;
+	};
+
+}
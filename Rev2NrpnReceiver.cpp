@@ -0,0 +1,108 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2NrpnReceiver.h"
+
+#include "Rev2ParamLayout.h"
+
+namespace midikraft {
+
+	Rev2NrpnReceiver::Rev2NrpnReceiver(int queueSize /* = 1024 */) : shadow_(2 * kSysexStartLayerB, 0), fifo_(queueSize), queue_((size_t)queueSize), dropped_(0)
+	{
+	}
+
+	bool Rev2NrpnReceiver::handleIncomingMessage(MidiMessage const &message)
+	{
+		if (!message.isController() || message.getChannel() < 1 || message.getChannel() > 16) {
+			return false;
+		}
+
+		ChannelState &state = channels_[message.getChannel() - 1];
+		int value = message.getControllerValue();
+		switch (message.getControllerNumber()) {
+		case 99:
+			// A new parameter number always starts with the MSB, the Rev2 sends MSB before LSB for both number and value
+			state.parameterMSB = value;
+			state.parameterLSB = -1;
+			state.valueMSB = -1;
+			return true;
+		case 98:
+			state.parameterLSB = value;
+			state.valueMSB = -1;
+			return true;
+		case 6:
+			state.valueMSB = value;
+			return true;
+		case 38:
+			if (state.parameterMSB != -1 && state.parameterLSB != -1 && state.valueMSB != -1) {
+				completed((state.parameterMSB << 7) | state.parameterLSB, (state.valueMSB << 7) | value);
+				// Running status - another value for the same parameter may follow without repeating 99 and 98
+				state.valueMSB = -1;
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void Rev2NrpnReceiver::completed(int nrpn, int value)
+	{
+		Update update;
+		update.nrpn = nrpn;
+		update.sysexIndex = Rev2ParamLayout::sysexIndexForNRPN(nrpn);
+		update.value = value;
+		if (update.sysexIndex != -1) {
+			shadow_[update.sysexIndex] = (uint8)value;
+		}
+
+		int start1, size1, start2, size2;
+		fifo_.prepareToWrite(1, start1, size1, start2, size2);
+		if (size1 + size2 == 0) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		queue_[size1 > 0 ? start1 : start2] = update;
+		fifo_.finishedWrite(1);
+	}
+
+	void Rev2NrpnReceiver::setEditBuffer(Synth::PatchData const &editBuffer)
+	{
+		jassert(editBuffer.size() == shadow_.size());
+		shadow_ = editBuffer;
+	}
+
+	Synth::PatchData const & Rev2NrpnReceiver::shadowEditBuffer() const
+	{
+		return shadow_;
+	}
+
+	int Rev2NrpnReceiver::readUpdates(Update *destination, int maxUpdates)
+	{
+		int start1, size1, start2, size2;
+		fifo_.prepareToRead(maxUpdates, start1, size1, start2, size2);
+		std::copy(queue_.begin() + start1, queue_.begin() + start1 + size1, destination);
+		std::copy(queue_.begin() + start2, queue_.begin() + start2 + size2, destination + size1);
+		fifo_.finishedRead(size1 + size2);
+		return size1 + size2;
+	}
+
+	void Rev2NrpnReceiver::processUpdates(std::function<void(Update const &)> callback)
+	{
+		Update batch[64];
+		int read;
+		while ((read = readUpdates(batch, 64)) > 0) {
+			for (int i = 0; i < read; i++) {
+				callback(batch[i]);
+			}
+		}
+	}
+
+	uint64 Rev2NrpnReceiver::droppedUpdates() const
+	{
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+}
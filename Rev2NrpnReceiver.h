@@ -0,0 +1,61 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+
+#include <array>
+#include <atomic>
+
+namespace midikraft {
+
+	// Follows the parameter changes the Rev2 sends when "MIDI Param Send" is set to NRPN. The four controller messages
+	// (99, 98, 6, 38) are reassembled per MIDI channel, the NRPN number is mapped to the sysex index of the layer, and the change
+	// is applied to a shadow copy of the edit buffer.
+	// handleIncomingMessage() and the shadow edit buffer belong to the MIDI thread. The changes are handed to one consumer, usually
+	// the UI thread, through a lock free single producer single consumer queue.
+	class Rev2NrpnReceiver {
+	public:
+		struct Update {
+			int nrpn; // Including the layer B offset
+			int sysexIndex; // Index in the 2048 byte patch, -1 for NRPNs that are not part of the patch (e.g. global settings)
+			int value;
+		};
+
+		Rev2NrpnReceiver(int queueSize = 1024);
+
+		// MIDI thread. Returns true if the message was part of an NRPN
+		bool handleIncomingMessage(MidiMessage const &message);
+		// MIDI thread. Resets the shadow buffer, e.g. when a complete edit buffer dump was received
+		void setEditBuffer(Synth::PatchData const &editBuffer);
+		Synth::PatchData const &shadowEditBuffer() const;
+
+		// Consumer thread. Returns the number of updates read into the destination
+		int readUpdates(Update *destination, int maxUpdates);
+		// Consumer thread. Calls the function for all updates waiting in the queue
+		void processUpdates(std::function<void(Update const &)> callback);
+
+		// Number of updates lost because the consumer did not keep up
+		uint64 droppedUpdates() const;
+
+	private:
+		struct ChannelState {
+			int parameterMSB = -1;
+			int parameterLSB = -1;
+			int valueMSB = -1;
+		};
+
+		void completed(int nrpn, int value);
+
+		std::array<ChannelState, 16> channels_;
+		Synth::PatchData shadow_;
+		AbstractFifo fifo_;
+		std::vector<Update> queue_;
+		std::atomic<uint64> dropped_;
+	};
+
+}
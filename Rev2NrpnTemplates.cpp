@@ -0,0 +1,81 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2NrpnTemplates.h"
+
+#include "Rev2Patch.h"
+#include "Rev2ParamLayout.h"
+
+#include <mutex>
+
+namespace midikraft {
+
+	// layerToSysex sends the first 88 parameter definitions, the sequencer arrays after them are not part of a layer push
+	const size_t kLayerParameterCount = 88;
+
+	Rev2NrpnTemplates const & Rev2NrpnTemplates::forChannel(MidiChannel channel)
+	{
+		static std::array<std::unique_ptr<Rev2NrpnTemplates>, 16> sTemplates;
+		static std::array<std::once_flag, 16> sBuilt;
+		int index = channel.toZeroBasedInt();
+		jassert(index >= 0 && index < 16);
+		index = std::min(15, std::max(0, index));
+		std::call_once(sBuilt[index], [index]() {
+			sTemplates[index].reset(new Rev2NrpnTemplates(index));
+		});
+		return *sTemplates[index];
+	}
+
+	Rev2NrpnTemplates::Rev2NrpnTemplates(int zeroBasedChannel) : templates_(2 * kSysexStartLayerB), valid_(2 * kSysexStartLayerB, false)
+	{
+		uint8 status = (uint8)(0xB0 | zeroBasedChannel);
+		for (int sysexIndex = 0; sysexIndex < (int)templates_.size(); sysexIndex++) {
+			int nrpn = Rev2ParamLayout::nrpnForSysexIndex(sysexIndex);
+			if (nrpn == -1) continue;
+			// Same order as MidiHelpers::generateRPN with 14 bit values and MSB before LSB
+			templates_[sysexIndex] = { status, 99, (uint8)((nrpn >> 7) & 0x7f), status, 98, (uint8)(nrpn & 0x7f), status, 6, 0, status, 38, 0 };
+			valid_[sysexIndex] = true;
+		}
+	}
+
+	bool Rev2NrpnTemplates::hasTemplate(int sysexIndex) const
+	{
+		return sysexIndex >= 0 && sysexIndex < (int)valid_.size() && valid_[sysexIndex];
+	}
+
+	void Rev2NrpnTemplates::append(std::vector<uint8> &rawMidi, int sysexIndex, int value) const
+	{
+		if (!hasTemplate(sysexIndex)) {
+			jassertfalse;
+			return;
+		}
+		size_t start = rawMidi.size();
+		auto const &nrpnTemplate = templates_[sysexIndex];
+		rawMidi.insert(rawMidi.end(), nrpnTemplate.begin(), nrpnTemplate.end());
+		rawMidi[start + 8] = (uint8)((value >> 7) & 0x7f);
+		rawMidi[start + 11] = (uint8)(value & 0x7f);
+	}
+
+	size_t Rev2NrpnTemplates::appendLayer(std::vector<uint8> &rawMidi, Synth::PatchData const &data, int sourceLayer, int targetLayer) const
+	{
+		auto const &definitions = Rev2Patch::parameterDefinitions();
+		size_t count = std::min(definitions.size(), kLayerParameterCount);
+		size_t appended = 0;
+		for (size_t i = 0; i < count; i++) {
+			int source = definitions[i].sysexIndex(sourceLayer);
+			int target = definitions[i].sysexIndex(targetLayer);
+			int length = definitions[i].endSysexIndex(sourceLayer) - source + 1;
+			for (int j = 0; j < length; j++) {
+				if (source + j < (int)data.size() && hasTemplate(target + j)) {
+					append(rawMidi, target + j, data[source + j]);
+					appended++;
+				}
+			}
+		}
+		return appended;
+	}
+
+}
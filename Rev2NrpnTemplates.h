@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+#include "MidiChannel.h"
+
+#include <array>
+
+namespace midikraft {
+
+	// The 12 bytes of the NRPN for every parameter byte of the Rev2, prepared for one MIDI channel:
+	//   Bn 63 <nrpn msb> Bn 62 <nrpn lsb> Bn 06 <value msb> Bn 26 <value lsb>
+	// Setting a parameter is then a copy of the template plus two value bytes into a raw MIDI buffer,
+	// instead of four MidiMessage objects in a new vector per value.
+	class Rev2NrpnTemplates {
+	public:
+		static const size_t kBytesPerNRPN = 12;
+
+		// Built on first use, one per channel
+		static Rev2NrpnTemplates const &forChannel(MidiChannel channel);
+
+		// sysexIndex is the index in the patch data, layer B parameters are at 1024 and above
+		bool hasTemplate(int sysexIndex) const;
+		void append(std::vector<uint8> &rawMidi, int sysexIndex, int value) const;
+
+		// The same parameters Rev2::layerToSysex sends, read from the source layer of the patch and addressed to the target layer.
+		// Returns the number of NRPNs appended
+		size_t appendLayer(std::vector<uint8> &rawMidi, Synth::PatchData const &data, int sourceLayer, int targetLayer) const;
+
+	private:
+		Rev2NrpnTemplates(int zeroBasedChannel);
+
+		typedef std::array<uint8, kBytesPerNRPN> Template;
+		std::vector<Template> templates_; // Indexed by sysex index
+		std::vector<bool> valid_;
+	};
+
+}
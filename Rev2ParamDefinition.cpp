@@ -1,5 +1,8 @@
 #include "Rev2ParamDefinition.h"
 
+#include "Rev2ParamLayout.h"
+#include "Rev2.h"
+
 #include "Capability.h"
 #include "Patch.h"
 
@@ -7,9 +10,6 @@
 
 namespace midikraft {
 
-	const int kSysexStartLayerB = 1024; // Layer B starts at sysex index 1024
-	const int kNRPNStartLayerB = 2048; // The NRPN numbers for layer B start 2048 higher than those for layer A
-
 	Rev2ParamDefinition::Rev2ParamDefinition(int number, int min, int max, std::string const &name, int sysExIndex) :
 		type_(ParamType::INT), targetLayer_(0), sourceLayer_(0), number_(number), min_(min), max_(max), name_(name), endNumber_(number), sysex_(sysExIndex)
 	{
@@ -61,33 +61,45 @@ namespace midikraft {
 		return name_;
 	}
 
+	int Rev2ParamDefinition::sysexIndex(int layerNo) const
+	{
+		jassert(layerNo == 0 || layerNo == 1);
+		return sysex_ + (layerNo == 1 ? kSysexStartLayerB : 0);
+	}
+
+	int Rev2ParamDefinition::endSysexIndex(int layerNo) const
+	{
+		// This is allowed because parameters with consecutive NRPN controller numbers are stored consecutively in the 
+		// sysex as well.
+		return sysexIndex(layerNo) + endNumber_ - number_;
+	}
+
+	int Rev2ParamDefinition::nrpn(int layerNo) const
+	{
+		jassert(layerNo == 0 || layerNo == 1);
+		return number_ + (layerNo == 1 ? kNRPNStartLayerB : 0);
+	}
+
 	int Rev2ParamDefinition::sysexIndex() const
 	{
-		jassert(targetLayer_ == 0 || targetLayer_ == 1);
-		return sysex_ + (targetLayer_ == 1 ? kSysexStartLayerB : 0);
+		return sysexIndex(targetLayer_);
 	}
 
 	int Rev2ParamDefinition::readSysexIndex() const
 	{
-		jassert(sourceLayer_ == 0 || sourceLayer_ == 1);
-		return sysex_ + (sourceLayer_ == 1 ? kSysexStartLayerB : 0);
+		return sysexIndex(sourceLayer_);
 	}
 
 	int Rev2ParamDefinition::endSysexIndex() const
 	{
-		// This is allowed because parameters with consecutive NRPN controller numbers are stored consecutively in the 
-		// sysex as well.
-		return sysexIndex() + endNumber_ - number_;
+		return endSysexIndex(targetLayer_);
 	}
 
 	int Rev2ParamDefinition::readEndSysexIndex() const
 	{
-		// This is allowed because parameters with consecutive NRPN controller numbers are stored consecutively in the 
-		// sysex as well.
-		return readSysexIndex() + endNumber_ - number_;
+		return endSysexIndex(sourceLayer_);
 	}
 
-
 	std::string Rev2ParamDefinition::description() const
 	{
 		return name_;
@@ -105,11 +117,21 @@ namespace midikraft {
 
 	bool Rev2ParamDefinition::valueInPatch(DataFile const &patch, int &outValue) const
 	{
-		outValue = patch.at(readSysexIndex());
+		return valueInPatch(patch, sourceLayer_, outValue);
+	}
+
+	bool Rev2ParamDefinition::valueInPatch(DataFile const &patch, int layerNo, int &outValue) const
+	{
+		outValue = patch.at(sysexIndex(layerNo));
 		return true;
 	}
 
 	bool Rev2ParamDefinition::valueInPatch(DataFile const &patch, std::vector<int> &outValue) const
+	{
+		return valueInPatch(patch, sourceLayer_, outValue);
+	}
+
+	bool Rev2ParamDefinition::valueInPatch(DataFile const &patch, int layerNo, std::vector<int> &outValue) const
 	{
 		// If this is not an array type, that won't work
 		if (type() != SynthParameterDefinition::ParamType::INT_ARRAY && type() != SynthParameterDefinition::ParamType::LOOKUP_ARRAY) {
@@ -117,7 +139,7 @@ namespace midikraft {
 		}
 
 		outValue.clear();
-		for (int i = readSysexIndex(); i <= readEndSysexIndex(); i++) {
+		for (int i = sysexIndex(layerNo); i <= endSysexIndex(layerNo); i++) {
 			outValue.push_back(patch.at(i));
 		}
 
@@ -127,33 +149,49 @@ namespace midikraft {
 	std::vector<MidiMessage> Rev2ParamDefinition::setValueMessages(std::shared_ptr<DataFile> const patch, Synth const *synth) const
 	{
 		auto midiLocation = midikraft::Capability::hasCapability<MidiLocationCapability const>(synth);
-		if (midiLocation) {
-			int nrpnNumberToUse = number_ + (targetLayer_ == 1 ? kNRPNStartLayerB : 0);
-			switch (type()) {
-			case SynthParameterDefinition::ParamType::LOOKUP:
-				// Fall through
-			case SynthParameterDefinition::ParamType::INT: {
-				int value;
-				if (valueInPatch(*patch, value)) {
-					return MidiHelpers::generateRPN(midiLocation->channel().toOneBasedInt(), nrpnNumberToUse, value, true, true, true);
-				}
+		if (midiLocation && patch) {
+			// A Rev2 might accept the cheaper CC messages for single values
+			auto rev2 = dynamic_cast<Rev2 const *>(synth);
+			int value;
+			if (rev2 && (type() == ParamType::INT || type() == ParamType::LOOKUP) && valueInPatch(*patch, sourceLayer_, value)) {
+				return rev2->parameterChangeMessages(nrpn(targetLayer_), value);
 			}
-			case SynthParameterDefinition::ParamType::LOOKUP_ARRAY:
-				// Fall through
-			case SynthParameterDefinition::ParamType::INT_ARRAY: {
-				std::vector<MidiMessage> result;
-				std::vector<int> values;
-				if (valueInPatch(*patch, values)) {
-					int idx = 0;
-					for (auto value : values) {
-						auto buffer = MidiHelpers::generateRPN(midiLocation->channel().toOneBasedInt(), nrpnNumberToUse + idx, value, true, true, true);
-						std::copy(buffer.cbegin(), buffer.cend(), std::back_inserter(result));
-						idx++;
-					}
-					return result;
-				}
+			return setValueMessages(*patch, midiLocation->channel(), sourceLayer_, targetLayer_);
+		}
+		return {};
+	}
+
+	std::vector<MidiMessage> Rev2ParamDefinition::setValueMessages(DataFile const &patch, MidiChannel channel, int sourceLayer, int targetLayer) const
+	{
+		int nrpnNumberToUse = nrpn(targetLayer);
+		switch (type()) {
+		case SynthParameterDefinition::ParamType::LOOKUP:
+			// Fall through
+		case SynthParameterDefinition::ParamType::INT: {
+			int value;
+			if (valueInPatch(patch, sourceLayer, value)) {
+				return MidiHelpers::generateRPN(channel.toOneBasedInt(), nrpnNumberToUse, value, true, true, true);
 			}
+			break;
+		}
+		case SynthParameterDefinition::ParamType::LOOKUP_ARRAY:
+			// Fall through
+		case SynthParameterDefinition::ParamType::INT_ARRAY: {
+			std::vector<MidiMessage> result;
+			std::vector<int> values;
+			if (valueInPatch(patch, sourceLayer, values)) {
+				int idx = 0;
+				for (auto value : values) {
+					auto buffer = MidiHelpers::generateRPN(channel.toOneBasedInt(), nrpnNumberToUse + idx, value, true, true, true);
+					std::copy(buffer.cbegin(), buffer.cend(), std::back_inserter(result));
+					idx++;
+				}
+				return result;
 			}
+			break;
+		}
+		default:
+			break;
 		}
 		return {};
 	}
@@ -181,11 +219,16 @@ namespace midikraft {
 	}
 
 	std::string Rev2ParamDefinition::valueInPatchToText(DataFile const &patch) const
+	{
+		return valueInPatchToText(patch, sourceLayer_);
+	}
+
+	std::string Rev2ParamDefinition::valueInPatchToText(DataFile const &patch, int layerNo) const
 	{
 		switch (type()) {
 		case SynthParameterDefinition::ParamType::INT: {
 			int value;
-			if (valueInPatch(patch, value)) {
+			if (valueInPatch(patch, layerNo, value)) {
 				return String(value).toStdString();
 			}
 			return "invalid param";
@@ -194,7 +237,7 @@ namespace midikraft {
 			// Fall through
 		case SynthParameterDefinition::ParamType::INT_ARRAY: {
 			std::vector<int> value;
-			if (valueInPatch(patch, value)) {
+			if (valueInPatch(patch, layerNo, value)) {
 				std::stringstream result;
 				result << "[";
 				for (size_t i = 0; i < value.size(); i++) {
@@ -213,7 +256,7 @@ namespace midikraft {
 		}
 		case SynthParameterDefinition::ParamType::LOOKUP:
 			int value;
-			if (valueInPatch(patch, value)) {
+			if (valueInPatch(patch, layerNo, value)) {
 				return lookupFunction_(value);
 			}
 			return "invalid lookup param";
@@ -222,15 +265,25 @@ namespace midikraft {
 	}
 
 	void Rev2ParamDefinition::setInPatch(DataFile &patch, int value) const
+	{
+		setInPatch(patch, targetLayer_, value);
+	}
+
+	void Rev2ParamDefinition::setInPatch(DataFile &patch, int layerNo, int value) const
 	{
 		jassert(type() == SynthParameterDefinition::ParamType::INT);
-		patch.setAt(sysexIndex(), (uint8)value);
+		patch.setAt(sysexIndex(layerNo), (uint8)value);
 	}
 
 	void Rev2ParamDefinition::setInPatch(DataFile &patch, std::vector<int> value) const
+	{
+		setInPatch(patch, targetLayer_, value);
+	}
+
+	void Rev2ParamDefinition::setInPatch(DataFile &patch, int layerNo, std::vector<int> const &value) const
 	{
 		int read = 0;
-		for (int i = sysexIndex(); i <= endSysexIndex(); i++) {
+		for (int i = sysexIndex(layerNo); i <= endSysexIndex(layerNo); i++) {
 			if (read < (int) value.size()) {
 				patch.setAt(i, (uint8)value[read++]);
 			}
@@ -246,4 +299,3 @@ namespace midikraft {
 	}
 
 }
-
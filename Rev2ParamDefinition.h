@@ -45,6 +45,19 @@ namespace midikraft {
 		virtual int getTargetLayer() const override;
 		virtual void setSourceLayer(int layerNo) override;
 		virtual int getSourceLayer() const override;
+
+		// Layer explicit access. These do not use the source and target layer set above, so one definition can be shared 
+		// between threads and layers without copying it
+		int sysexIndex(int layerNo) const;
+		int endSysexIndex(int layerNo) const;
+		int nrpn(int layerNo) const;
+		bool valueInPatch(DataFile const &patch, int layerNo, int &outValue) const;
+		bool valueInPatch(DataFile const &patch, int layerNo, std::vector<int> &outValue) const;
+		void setInPatch(DataFile &patch, int layerNo, int value) const;
+		void setInPatch(DataFile &patch, int layerNo, std::vector<int> const &value) const;
+		std::string valueInPatchToText(DataFile const &patch, int layerNo) const;
+		// Reads the value(s) from the source layer of the patch, and creates the NRPN messages to set them in the target layer of the synth
+		std::vector<MidiMessage> setValueMessages(DataFile const &patch, MidiChannel channel, int sourceLayer, int targetLayer) const;
 	private:
 		ParamType type_;
 		int targetLayer_; // The Rev2 has no layers, A (=0) and B (=0). By default, we target 0 but can change this calling setTargetLayer()
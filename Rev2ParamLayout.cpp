@@ -0,0 +1,82 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2ParamLayout.h"
+
+namespace midikraft {
+
+	// The reverse tables are computed by the compiler, so there is no static initialization cost
+	constexpr std::array<int16, kNRPNStartLayerB> buildParamByNRPN() {
+		std::array<int16, kNRPNStartLayerB> result = {};
+		for (auto &entry : result) entry = -1;
+		for (int i = 0; i < (int)Rev2Param::NUMBER_OF_PARAMS; i++) {
+			for (int nrpn = kRev2ParamLayout[i].nrpn; nrpn <= kRev2ParamLayout[i].endNrpn; nrpn++) {
+				result[nrpn] = (int16)i;
+			}
+		}
+		return result;
+	}
+
+	constexpr std::array<int16, kSysexStartLayerB> buildParamBySysexIndex() {
+		std::array<int16, kSysexStartLayerB> result = {};
+		for (auto &entry : result) entry = -1;
+		for (int i = 0; i < (int)Rev2Param::NUMBER_OF_PARAMS; i++) {
+			for (int index = kRev2ParamLayout[i].sysexIndex; index <= kRev2ParamLayout[i].endSysexIndex(); index++) {
+				result[index] = (int16)i;
+			}
+		}
+		return result;
+	}
+
+	constexpr std::array<int8, kNRPNStartLayerB> buildControllerByNRPN() {
+		std::array<int8, kNRPNStartLayerB> result = {};
+		for (auto &entry : result) entry = -1;
+		for (auto const &mapping : kRev2ControllerMappings) {
+			result[kRev2ParamLayout[(int)mapping.param].nrpn] = (int8)mapping.controller;
+		}
+		return result;
+	}
+
+	constexpr std::array<int16, kNRPNStartLayerB> kParamByNRPN = buildParamByNRPN();
+	constexpr std::array<int16, kSysexStartLayerB> kParamBySysexIndex = buildParamBySysexIndex();
+	constexpr std::array<int8, kNRPNStartLayerB> kControllerByNRPN = buildControllerByNRPN();
+
+	int Rev2ParamLayout::sysexIndexForNRPN(int nrpn)
+	{
+		if (nrpn < 0 || nrpn >= 2 * kNRPNStartLayerB) return -1;
+		int layerOffset = nrpn >= kNRPNStartLayerB ? kSysexStartLayerB : 0;
+		int layerNRPN = nrpn % kNRPNStartLayerB;
+		int param = kParamByNRPN[layerNRPN];
+		if (param == -1) return -1;
+		auto const &p = kRev2ParamLayout[param];
+		return p.sysexIndex + (layerNRPN - p.nrpn) + layerOffset;
+	}
+
+	int Rev2ParamLayout::nrpnForSysexIndex(int sysexIndex)
+	{
+		if (sysexIndex < 0 || sysexIndex >= 2 * kSysexStartLayerB) return -1;
+		int layerOffset = sysexIndex >= kSysexStartLayerB ? kNRPNStartLayerB : 0;
+		int layerIndex = sysexIndex % kSysexStartLayerB;
+		int param = kParamBySysexIndex[layerIndex];
+		if (param == -1) return -1;
+		auto const &p = kRev2ParamLayout[param];
+		return p.nrpn + (layerIndex - p.sysexIndex) + layerOffset;
+	}
+
+	int Rev2ParamLayout::controllerForNRPN(int nrpn)
+	{
+		if (nrpn < 0 || nrpn >= kNRPNStartLayerB) return -1;
+		return kControllerByNRPN[nrpn];
+	}
+
+	Rev2ParamDescriptor const * Rev2ParamLayout::findByNRPN(int nrpn)
+	{
+		if (nrpn < 0 || nrpn >= 2 * kNRPNStartLayerB) return nullptr;
+		int param = kParamByNRPN[nrpn % kNRPNStartLayerB];
+		return param == -1 ? nullptr : &kRev2ParamLayout[param];
+	}
+
+}
@@ -0,0 +1,533 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+
+#include <array>
+
+namespace midikraft {
+
+	inline constexpr int kSysexStartLayerB = 1024; // Layer B starts at sysex index 1024
+	inline constexpr int kNRPNStartLayerB = 2048; // The NRPN numbers for layer B start 2048 higher than those for layer A
+
+	enum class Rev2Layer {
+		A = 0,
+		B = 1
+	};
+
+	// All parameters of a Rev2 layer, in the order of the layout table below
+	enum class Rev2Param {
+		Osc1Freq,
+		Osc1FreqFine,
+		Osc1ShapeMod,
+		Osc1Glide,
+		Osc1KeyOnOff,
+		Osc2Freq,
+		Osc2FreqFine,
+		Osc2ShapeMod,
+		Osc2Glide,
+		Osc2KeyOnOff,
+		SyncOnOff,
+		GlideMode,
+		OscSlop,
+		OscMix,
+		NoiseLevel,
+		Cutoff,
+		Resonance,
+		LPFKeyAmt,
+		LPFAudioMod,
+		FilterPoles,
+		EnvLPFAmt,
+		EnvLPFVelAmt,
+		EnvLPFDelay,
+		EnvLPFAttack,
+		EnvLPFDecay,
+		EnvLPFSustain,
+		EnvLPFRelease,
+		PanSpread,
+		ProgramVolume,
+		EnvVCAAmt,
+		EnvVCAVelAmt,
+		EnvVCADelay,
+		EnvVCAAttack,
+		EnvVCADecay,
+		EnvVCASustain,
+		EnvVCARelease,
+		LFO1Freq,
+		LFO1Shape,
+		LFO1Amt,
+		LFO1Dest,
+		LFO1ClockSync,
+		LFO2Freq,
+		LFO2Shape,
+		LFO2Amt,
+		LFO2Dest,
+		LFO2ClockSync,
+		LFO3Freq,
+		LFO3Shape,
+		LFO3Amt,
+		LFO3Dest,
+		LFO3ClockSync,
+		LFO4Freq,
+		LFO4Shape,
+		LFO4Amt,
+		LFO4Dest,
+		LFO4ClockSync,
+		Env3Dest,
+		Env3Amount,
+		Env3VelAmt,
+		Env3Delay,
+		Env3Attack,
+		Env3Decay,
+		Env3Sustain,
+		Env3Release,
+		Mod1Source,
+		Mod1Amount,
+		Mod1Dest,
+		Mod2Source,
+		Mod2Amount,
+		Mod2Dest,
+		Mod3Source,
+		Mod3Amount,
+		Mod3Dest,
+		Mod4Source,
+		Mod4Amount,
+		Mod4Dest,
+		Mod5Source,
+		Mod5Amount,
+		Mod5Dest,
+		Mod6Source,
+		Mod6Amount,
+		Mod6Dest,
+		Mod7Source,
+		Mod7Amount,
+		Mod7Dest,
+		Mod8Source,
+		Mod8Amount,
+		Mod8Dest,
+		Env3Repeat,
+		VCALevel,
+		Osc1NoteReset,
+		Osc1PulseWidth,
+		Osc2PulseWidth,
+		Osc2NoteReset,
+		LFO1KeySync,
+		LFO2KeySync,
+		LFO3KeySync,
+		LFO4KeySync,
+		SubLevel,
+		GlideOnOff,
+		PitchBendRange,
+		PanModMode,
+		ModWheelAmount,
+		ModWheelDest,
+		PressureAmount,
+		PressureDest,
+		BreathAmount,
+		BreathDest,
+		VelocityAmount,
+		VelocityDest,
+		FootCtrlAmount,
+		FootCtrlDest,
+		FXOnOff,
+		FXType,
+		FXMix,
+		FXParam1,
+		FXParam2,
+		FXClockSync,
+		ABMode,
+		PolySeqStartStop,
+		UnisonDetune,
+		UnisonOnOff,
+		UnisonMode,
+		KeyMode,
+		SplitPoint,
+		ArpOnOff,
+		ArpMode,
+		ArpOctave,
+		ClockDivide,
+		ArpRepeats,
+		ArpRelatch,
+		BPMTempo,
+		GatedSeqMode,
+		SeqMode,
+		Seq1Dest,
+		Seq2Dest,
+		Seq3Dest,
+		Seq4Dest,
+		SeqTrack1,
+		SeqTrack2,
+		SeqTrack3,
+		SeqTrack4,
+		PolySeqNote1,
+		PolySeqVel1,
+		PolySeqNote2,
+		PolySeqVel2,
+		PolySeqNote3,
+		PolySeqVel3,
+		PolySeqNote4,
+		PolySeqVel4,
+		PolySeqNote5,
+		PolySeqVel5,
+		PolySeqNote6,
+		PolySeqVel6,
+		NUMBER_OF_PARAMS
+	};
+
+	// How values of a parameter are displayed, the lookup tables themselves live with the parameter definitions
+	enum class Rev2ValueLookup {
+		NONE,
+		NOTE_NAME,
+		OSC_SHAPE,
+		GLIDE_MODE,
+		FILTER_POLES,
+		LFO_SHAPE,
+		LFO_DESTINATION,
+		MOD_SOURCE,
+		PAN_MOD_MODE,
+		FX_TYPE,
+		AB_MODE,
+		KEY_MODE,
+		ARP_MODE,
+		CLOCK_DIVIDE,
+		GATED_SEQ_MODE,
+		SEQ_MODE
+	};
+
+	struct Rev2ParamDescriptor {
+		Rev2Param param;
+		int nrpn;
+		int endNrpn; // Same as nrpn unless this is an array parameter
+		int minValue;
+		int maxValue;
+		const char *name;
+		int sysexIndex; // In layer A
+		Rev2ValueLookup lookup;
+
+		constexpr bool isArray() const { return endNrpn != nrpn; }
+		// Parameters with consecutive NRPN controller numbers are stored consecutively in the sysex as well
+		constexpr int length() const { return endNrpn - nrpn + 1; }
+		constexpr int endSysexIndex() const { return sysexIndex + length() - 1; }
+	};
+
+	// The sysex layout of one Rev2 layer. Layer B uses the same layout, offset by kSysexStartLayerB and kNRPNStartLayerB
+	inline constexpr Rev2ParamDescriptor kRev2ParamLayout[] = {
+		{ Rev2Param::Osc1Freq, 0, 0, 0, 120, "Osc 1 Freq", 0, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::Osc1FreqFine, 1, 1, 0, 100, "Osc 1 Freq Fine", 2, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc1ShapeMod, 2, 2, 0, 4, "Osc 1 Shape Mod", 4, Rev2ValueLookup::OSC_SHAPE },
+		{ Rev2Param::Osc1Glide, 3, 3, 0, 127, "Osc 1 Glide", 8, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc1KeyOnOff, 4, 4, 0, 1, "Osc 1 Key On/Off", 10, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc2Freq, 5, 5, 0, 120, "Osc 2 Freq", 1, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::Osc2FreqFine, 6, 6, 0, 100, "Osc 2 Freq Fine", 3, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc2ShapeMod, 7, 7, 0, 4, "Osc 2 Shape Mod", 5, Rev2ValueLookup::OSC_SHAPE },
+		{ Rev2Param::Osc2Glide, 8, 8, 0, 127, "Osc 2 Glide", 9, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc2KeyOnOff, 9, 9, 0, 1, "Osc. 2 Key On/Off", 11, Rev2ValueLookup::NONE },
+		{ Rev2Param::SyncOnOff, 10, 10, 0, 1, "Sync On/Off", 17, Rev2ValueLookup::NONE },
+		{ Rev2Param::GlideMode, 11, 11, 0, 3, "Glide Mode", 18, Rev2ValueLookup::GLIDE_MODE },
+		{ Rev2Param::OscSlop, 12, 12, 0, 127, "Osc Slop", 21, Rev2ValueLookup::NONE },
+		{ Rev2Param::OscMix, 13, 13, 0, 127, "Osc 1/2 Mix", 14, Rev2ValueLookup::NONE },
+		{ Rev2Param::NoiseLevel, 14, 14, 0, 127, "Noise Level", 16, Rev2ValueLookup::NONE },
+		{ Rev2Param::Cutoff, 15, 15, 0, 164, "Cutoff", 22, Rev2ValueLookup::NONE },
+		{ Rev2Param::Resonance, 16, 16, 0, 127, "Resonance", 23, Rev2ValueLookup::NONE },
+		{ Rev2Param::LPFKeyAmt, 17, 17, 0, 127, "LPF Key Amt", 24, Rev2ValueLookup::NONE },
+		{ Rev2Param::LPFAudioMod, 18, 18, 0, 127, "LPF Audio Mod", 25, Rev2ValueLookup::NONE },
+		{ Rev2Param::FilterPoles, 19, 19, 0, 1, "2 pole/4 pole mode", 26, Rev2ValueLookup::FILTER_POLES },
+		{ Rev2Param::EnvLPFAmt, 20, 20, 0, 254, "Env LPF Amt", 32, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvLPFVelAmt, 21, 21, 0, 127, "Env LPF Vel Amt", 35, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvLPFDelay, 22, 22, 0, 127, "Env LPF Delay", 38, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvLPFAttack, 23, 23, 0, 127, "Env LPF Attack", 41, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvLPFDecay, 24, 24, 0, 127, "Env LPF Decay", 44, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvLPFSustain, 25, 25, 0, 127, "Env LPF Sustain", 47, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvLPFRelease, 26, 26, 0, 127, "Env LPF Release", 50, Rev2ValueLookup::NONE },
+		// 27 is really empty.If you try to set this, you get a change in index #33
+		{ Rev2Param::PanSpread, 28, 28, 0, 127, "Pan Spread", 29, Rev2ValueLookup::NONE },
+		{ Rev2Param::ProgramVolume, 29, 29, 0, 127, "Program Volume", 28, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCAAmt, 30, 30, 0, 127, "Env VCA Amt", 33, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCAVelAmt, 31, 31, 0, 127, "Env VCA Vel Amt", 36, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCADelay, 32, 32, 0, 127, "Env VCA Delay", 39, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCAAttack, 33, 33, 0, 127, "Env VCA Attack", 42, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCADecay, 34, 34, 0, 127, "Env VCA Decay", 45, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCASustain, 35, 35, 0, 127, "Env VCA Sustain", 48, Rev2ValueLookup::NONE },
+		{ Rev2Param::EnvVCARelease, 36, 36, 0, 127, "Env VCA Release", 51, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO1Freq, 37, 37, 0, 150, "LFO 1 Freq", 53, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO1Shape, 38, 38, 0, 4, "LFO 1 Shape", 57, Rev2ValueLookup::LFO_SHAPE },
+		{ Rev2Param::LFO1Amt, 39, 39, 0, 127, "LFO 1 Amt", 61, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO1Dest, 40, 40, 0, 52, "LFO 1 Dest", 65, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::LFO1ClockSync, 41, 41, 0, 1, "LFO 1 Clock Sync", 69, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO2Freq, 42, 42, 0, 150, "LFO 2 Freq", 54, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO2Shape, 43, 43, 0, 4, "LFO 2 Shape", 58, Rev2ValueLookup::LFO_SHAPE },
+		{ Rev2Param::LFO2Amt, 44, 44, 0, 127, "LFO 2 Amt", 62, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO2Dest, 45, 45, 0, 52, "LFO 2 Dest", 66, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::LFO2ClockSync, 46, 46, 0, 1, "LFO 2 Clock Sync", 70, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO3Freq, 47, 47, 0, 150, "LFO 3 Freq", 55, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO3Shape, 48, 48, 0, 4, "LFO 3 Shape", 59, Rev2ValueLookup::LFO_SHAPE },
+		{ Rev2Param::LFO3Amt, 49, 49, 0, 127, "LFO 3 Amt", 63, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO3Dest, 50, 50, 0, 52, "LFO 3 Dest", 67, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::LFO3ClockSync, 51, 51, 0, 1, "LFO 3 Clock Sync", 71, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO4Freq, 52, 52, 0, 150, "LFO 4 Freq", 56, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO4Shape, 53, 53, 0, 4, "LFO 4 Shape", 60, Rev2ValueLookup::LFO_SHAPE },
+		{ Rev2Param::LFO4Amt, 54, 54, 0, 127, "LFO 4 Amt", 64, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO4Dest, 55, 55, 0, 52, "LFO 4 Dest", 68, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::LFO4ClockSync, 56, 56, 0, 1, "LFO 4 Clock Sync", 72, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3Dest, 57, 57, 0, 52, "Env 3 Dest", 30, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Env3Amount, 58, 58, 0, 254, "Env 3 Amount", 34, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3VelAmt, 59, 59, 0, 127, "Env 3 Vel Amt", 37, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3Delay, 60, 60, 0, 127, "Env 3 Delay", 40, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3Attack, 61, 61, 0, 127, "Env 3 Attack", 43, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3Decay, 62, 62, 0, 127, "Env 3 Decay", 46, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3Sustain, 63, 63, 0, 127, "Env 3 Sustain", 49, Rev2ValueLookup::NONE },
+		{ Rev2Param::Env3Release, 64, 64, 0, 127, "Env 3 Release", 52, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod1Source, 65, 65, 0, 22, "Mod 1 Source", 77, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod1Amount, 66, 66, 0, 254, "Mod 1 Amount", 85, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod1Dest, 67, 67, 0, 52, "Mod 1 Dest", 93, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod2Source, 68, 68, 0, 22, "Mod 2 Source", 78, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod2Amount, 69, 69, 0, 254, "Mod 2 Amount", 86, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod2Dest, 70, 70, 0, 52, "Mod 2 Dest", 94, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod3Source, 71, 71, 0, 22, "Mod 3 Source", 79, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod3Amount, 72, 72, 0, 254, "Mode 3 Amount", 87, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod3Dest, 73, 73, 0, 52, "Mode 3 Dest", 95, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod4Source, 74, 74, 0, 22, "Mod 4 Source", 80, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod4Amount, 75, 75, 0, 254, "Mod 4 Amount", 88, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod4Dest, 76, 76, 0, 52, "Mod 4 Dest", 96, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod5Source, 77, 77, 0, 22, "Mod 5 Source", 81, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod5Amount, 78, 78, 0, 254, "Mod 5 Amount", 89, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod5Dest, 79, 79, 0, 52, "Mod 5 Dest", 97, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod6Source, 80, 80, 0, 22, "Mod 6 Source", 82, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod6Amount, 81, 81, 0, 254, "Mod 6 Amount", 90, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod6Dest, 82, 82, 0, 52, "Mod 6 Dest", 98, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod7Source, 83, 83, 0, 22, "Mod 7 Source", 83, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod7Amount, 84, 84, 0, 254, "Mod 7 Amount", 91, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod7Dest, 85, 85, 0, 52, "Mod 7 Dest", 99, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Mod8Source, 86, 86, 0, 22, "Mod 8 Source", 84, Rev2ValueLookup::MOD_SOURCE },
+		{ Rev2Param::Mod8Amount, 87, 87, 0, 254, "Mod 8 Amount", 92, Rev2ValueLookup::NONE },
+		{ Rev2Param::Mod8Dest, 88, 88, 0, 52, "Mod 8 Dest", 100, Rev2ValueLookup::LFO_DESTINATION },
+		// TODO - really no values ?
+		{ Rev2Param::Env3Repeat, 97, 97, 0, 1, "Env 3 Repeat", 31, Rev2ValueLookup::NONE },
+		{ Rev2Param::VCALevel, 98, 98, 0, 127, "VCA Level", 27, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc1NoteReset, 99, 99, 0, 1, "Osc 1 Note Reset", 12, Rev2ValueLookup::NONE },
+		// TODO - really no values ?
+		{ Rev2Param::Osc1PulseWidth, 102, 102, 0, 99, "Osc 1 Pulse Width", 6, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc2PulseWidth, 103, 103, 0, 99, "Osc 2 Pulse Width", 7, Rev2ValueLookup::NONE },
+		{ Rev2Param::Osc2NoteReset, 104, 104, 0, 1, "Osc 2 Note Reset", 13, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO1KeySync, 105, 105, 0, 1, "LFO 1 Key Sync", 73, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO2KeySync, 106, 106, 0, 1, "LFO 2 Key Sync", 74, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO3KeySync, 107, 107, 0, 1, "LFO 3 Key Sync", 75, Rev2ValueLookup::NONE },
+		{ Rev2Param::LFO4KeySync, 108, 108, 0, 1, "LFO 4 Key Sync", 76, Rev2ValueLookup::NONE },
+		// TODO - really no values ?
+		{ Rev2Param::SubLevel, 110, 110, 0, 127, "Sub Level", 15, Rev2ValueLookup::NONE },
+		{ Rev2Param::GlideOnOff, 111, 111, 0, 1, "Glide On/Off", 19, Rev2ValueLookup::NONE },
+		// TODO - really no values ?
+		{ Rev2Param::PitchBendRange, 113, 113, 0, 12, "Pitch Bend Range", 20, Rev2ValueLookup::NONE },
+		{ Rev2Param::PanModMode, 114, 114, 0, 1, "Pan Mod Mode", 209, Rev2ValueLookup::PAN_MOD_MODE },
+		// TODO - really no values ?
+		{ Rev2Param::ModWheelAmount, 116, 116, 0, 254, "Mod Wheel Amount", 101, Rev2ValueLookup::NONE },
+		{ Rev2Param::ModWheelDest, 117, 117, 0, 52, "Mod Wheel Dest", 102, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::PressureAmount, 118, 118, 0, 254, "Pressure Amount", 103, Rev2ValueLookup::NONE },
+		{ Rev2Param::PressureDest, 119, 119, 0, 52, "Pressure Dest", 104, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::BreathAmount, 120, 120, 0, 254, "Breath Amount", 105, Rev2ValueLookup::NONE },
+		{ Rev2Param::BreathDest, 121, 121, 0, 52, "Breath Dest", 106, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::VelocityAmount, 122, 122, 0, 254, "Velocity Amount", 107, Rev2ValueLookup::NONE },
+		{ Rev2Param::VelocityDest, 123, 123, 0, 52, "Velocity Dest", 108, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::FootCtrlAmount, 124, 124, 0, 254, "Foot Ctrl Amount", 109, Rev2ValueLookup::NONE },
+		{ Rev2Param::FootCtrlDest, 125, 125, 0, 52, "Foot Ctrl Dest", 110, Rev2ValueLookup::LFO_DESTINATION },
+		// TODO - really no values ?
+		{ Rev2Param::FXOnOff, 153, 153, 0, 1, "FX On/Off", 116, Rev2ValueLookup::NONE },
+		{ Rev2Param::FXType, 154, 154, 0, 13, "FX Type", 115, Rev2ValueLookup::FX_TYPE },
+		{ Rev2Param::FXMix, 155, 155, 0, 127, "FX Mix", 117, Rev2ValueLookup::NONE },
+		{ Rev2Param::FXParam1, 156, 156, 0, 255, "FX Param 1", 118, Rev2ValueLookup::NONE },
+		{ Rev2Param::FXParam2, 157, 157, 0, 127, "FX Param 2", 119, Rev2ValueLookup::NONE },
+		{ Rev2Param::FXClockSync, 158, 158, 0, 1, "FX Clock Sync", 120, Rev2ValueLookup::NONE },
+		// TODO - really no values ?
+		{ Rev2Param::ABMode, 163, 163, 0, 2, "A/B Mode", 231, Rev2ValueLookup::AB_MODE },
+		{ Rev2Param::PolySeqStartStop, 164, 164, 0, 1, "Poly Seq Start/Stop", 137, Rev2ValueLookup::NONE },
+		// TODO - really no values ?
+		{ Rev2Param::UnisonDetune, 167, 167, 0, 16, "Unison Detune", 208, Rev2ValueLookup::NONE },
+		{ Rev2Param::UnisonOnOff, 168, 168, 0, 1, "Unison On/Off", 123, Rev2ValueLookup::NONE },
+		{ Rev2Param::UnisonMode, 169, 169, 0, 16, "Unison Mode", 124, Rev2ValueLookup::NONE },
+		{ Rev2Param::KeyMode, 170, 170, 0, 5, "Key Mode", 122, Rev2ValueLookup::KEY_MODE },
+		{ Rev2Param::SplitPoint, 171, 171, 0, 120, "Split Point", 232, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::ArpOnOff, 172, 172, 0, 1, "Arp On/Off", 136, Rev2ValueLookup::NONE },
+		{ Rev2Param::ArpMode, 173, 173, 0, 4, "Arp Mode", 132, Rev2ValueLookup::ARP_MODE },
+		{ Rev2Param::ArpOctave, 174, 174, 0, 2, "Arp Octave", 133, Rev2ValueLookup::NONE },
+		{ Rev2Param::ClockDivide, 175, 175, 0, 12, "Clock Divide", 131, Rev2ValueLookup::CLOCK_DIVIDE },
+		// TODO - really no values ?
+		{ Rev2Param::ArpRepeats, 177, 177, 0, 3, "Arp Repeats", 134, Rev2ValueLookup::NONE },
+		{ Rev2Param::ArpRelatch, 178, 178, 0, 1, "Arp Relatch", 135, Rev2ValueLookup::NONE },
+		{ Rev2Param::BPMTempo, 179, 179, 30, 250, "BPM Tempo", 130, Rev2ValueLookup::NONE },
+		// TODO - really no values ?
+		{ Rev2Param::GatedSeqMode, 182, 182, 0, 4, "Gated Seq Mode", 138, Rev2ValueLookup::GATED_SEQ_MODE },
+		{ Rev2Param::SeqMode, 183, 183, 0, 1, "Seq Mode", 139, Rev2ValueLookup::SEQ_MODE },
+		{ Rev2Param::Seq1Dest, 184, 184, 0, 52, "Seq 1 Dest", 111, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Seq2Dest, 185, 185, 0, 53, "Seq 2 Dest", 112, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Seq3Dest, 186, 186, 0, 52, "Seq 3 Dest", 113, Rev2ValueLookup::LFO_DESTINATION },
+		{ Rev2Param::Seq4Dest, 187, 187, 0, 53, "Seq 4 Dest", 114, Rev2ValueLookup::LFO_DESTINATION },
+		// TODO - really no values ?
+		{ Rev2Param::SeqTrack1, 192, 207, 0, 127, "Seq Track 1", 140, Rev2ValueLookup::NONE }, // 126 is Reset, 127 is the Rest (Rest only on Track 1)
+		{ Rev2Param::SeqTrack2, 208, 223, 0, 126, "Seq Track 2", 156, Rev2ValueLookup::NONE }, // 126 is Reset
+		{ Rev2Param::SeqTrack3, 224, 239, 0, 126, "Seq Track 3", 172, Rev2ValueLookup::NONE }, // 126 is Reset
+		{ Rev2Param::SeqTrack4, 240, 255, 0, 126, "Seq Track 4", 188, Rev2ValueLookup::NONE }, // 126 is Reset
+		// TODO - really no values ?
+		{ Rev2Param::PolySeqNote1, 276, 339, 0, 127, "Poly Seq Note 1", 256, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::PolySeqVel1, 340, 403, 128, 255, "Poly Seq Vel 1", 320, Rev2ValueLookup::NONE },
+		{ Rev2Param::PolySeqNote2, 404, 467, 0, 127, "Poly Seq Note 2", 384, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::PolySeqVel2, 468, 531, 128, 255, "Poly Seq Vel 2", 448, Rev2ValueLookup::NONE },
+		{ Rev2Param::PolySeqNote3, 532, 595, 0, 127, "Poly Seq Note 3", 512, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::PolySeqVel3, 596, 659, 128, 255, "Poly Seq Vel 3", 576, Rev2ValueLookup::NONE },
+		{ Rev2Param::PolySeqNote4, 660, 723, 0, 127, "Poly Seq Note 4", 640, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::PolySeqVel4, 724, 787, 128, 255, "Poly Seq Vel 4", 704, Rev2ValueLookup::NONE },
+		{ Rev2Param::PolySeqNote5, 788, 851, 0, 127, "Poly Seq Note 5", 768, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::PolySeqVel5, 852, 915, 128, 255, "Poly Seq Vel 5", 832, Rev2ValueLookup::NONE },
+		{ Rev2Param::PolySeqNote6, 916, 979, 0, 127, "Poly Seq Note 6", 896, Rev2ValueLookup::NOTE_NAME },
+		{ Rev2Param::PolySeqVel6, 980, 1043, 128, 255, "Poly Seq Vel 6", 960, Rev2ValueLookup::NONE },
+	};
+
+	// Parameters that can also be set with a plain controller message when "MIDI Param Receive" is set to CC. The CC always
+	// targets the layer currently selected on the synth. The Rev2 scales a received CC 0 to 127 onto the full parameter range,
+	// so only parameters ranging exactly 0 to 127 are listed, for them the CC value is the same as the NRPN value. Parameters
+	// like Cutoff (0 to 164) or the oscillator frequencies (0 to 120) have a CC on the synth too, but are always sent as NRPN
+	struct Rev2ControllerMapping {
+		Rev2Param param;
+		int controller;
+	};
+
+	inline constexpr Rev2ControllerMapping kRev2ControllerMappings[] = {
+		{ Rev2Param::Osc1Glide, 23 },
+		{ Rev2Param::Osc2Glide, 27 },
+		{ Rev2Param::OscMix, 28 },
+		{ Rev2Param::NoiseLevel, 29 },
+		{ Rev2Param::Resonance, 103 },
+		{ Rev2Param::LPFKeyAmt, 104 },
+		{ Rev2Param::LPFAudioMod, 105 },
+		{ Rev2Param::EnvLPFVelAmt, 107 },
+		{ Rev2Param::EnvLPFDelay, 108 },
+		{ Rev2Param::EnvLPFAttack, 109 },
+		{ Rev2Param::EnvLPFDecay, 110 },
+		{ Rev2Param::EnvLPFSustain, 111 },
+		{ Rev2Param::EnvLPFRelease, 112 },
+	};
+
+	namespace Rev2LayoutValidation {
+
+		constexpr bool entriesMatchEnum() {
+			for (int i = 0; i < (int)Rev2Param::NUMBER_OF_PARAMS; i++) {
+				if (kRev2ParamLayout[i].param != Rev2Param(i)) return false;
+			}
+			return true;
+		}
+
+		constexpr bool rangesAreSane() {
+			for (auto const &p : kRev2ParamLayout) {
+				if (p.minValue > p.maxValue || p.endNrpn < p.nrpn || p.endNrpn >= kNRPNStartLayerB) return false;
+				if (p.sysexIndex < 0 || p.endSysexIndex() >= kSysexStartLayerB) return false;
+			}
+			return true;
+		}
+
+		constexpr bool overlaps(int start1, int end1, int start2, int end2) {
+			return start1 <= end2 && start2 <= end1;
+		}
+
+		constexpr bool noSysexOverlaps() {
+			for (int i = 0; i < (int)Rev2Param::NUMBER_OF_PARAMS; i++) {
+				for (int j = i + 1; j < (int)Rev2Param::NUMBER_OF_PARAMS; j++) {
+					auto const &a = kRev2ParamLayout[i];
+					auto const &b = kRev2ParamLayout[j];
+					if (overlaps(a.sysexIndex, a.endSysexIndex(), b.sysexIndex, b.endSysexIndex())) return false;
+				}
+			}
+			return true;
+		}
+
+		constexpr bool noNRPNOverlaps() {
+			for (int i = 0; i < (int)Rev2Param::NUMBER_OF_PARAMS; i++) {
+				for (int j = i + 1; j < (int)Rev2Param::NUMBER_OF_PARAMS; j++) {
+					if (overlaps(kRev2ParamLayout[i].nrpn, kRev2ParamLayout[i].endNrpn, kRev2ParamLayout[j].nrpn, kRev2ParamLayout[j].endNrpn)) return false;
+				}
+			}
+			return true;
+		}
+
+		constexpr bool controllerMappingsAreValid() {
+			for (auto const &mapping : kRev2ControllerMappings) {
+				if (mapping.controller < 0 || mapping.controller > 119) return false;
+				if (kRev2ParamLayout[(int)mapping.param].isArray()) return false;
+				if (kRev2ParamLayout[(int)mapping.param].minValue != 0 || kRev2ParamLayout[(int)mapping.param].maxValue != 127) return false;
+				for (auto const &other : kRev2ControllerMappings) {
+					if (&other != &mapping && (other.controller == mapping.controller || other.param == mapping.param)) return false;
+				}
+			}
+			return true;
+		}
+
+		static_assert(sizeof(kRev2ParamLayout) / sizeof(kRev2ParamLayout[0]) == (size_t)Rev2Param::NUMBER_OF_PARAMS, "Rev2 layout table and Rev2Param enum differ in size");
+		static_assert(entriesMatchEnum(), "Rev2 layout table is not in the order of the Rev2Param enum");
+		static_assert(rangesAreSane(), "Rev2 layout has an invalid value, NRPN, or sysex range");
+		static_assert(noSysexOverlaps(), "Two Rev2 parameters share sysex bytes");
+		static_assert(noNRPNOverlaps(), "Two Rev2 parameters share NRPN numbers");
+		static_assert(controllerMappingsAreValid(), "Rev2 controller mappings must be unique, scalar 0 to 127 parameters and controllers 0 to 119");
+	}
+
+	// Typed access to the patch data, e.g. Rev2ParamLayout::get<Rev2Param::Cutoff, Rev2Layer::B>(patch).
+	// The sysex index is a compile time constant, so this is a single byte load
+	class Rev2ParamLayout {
+	public:
+		static constexpr Rev2ParamDescriptor const &descriptor(Rev2Param param) {
+			return kRev2ParamLayout[(int)param];
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static constexpr int sysexIndex() {
+			return descriptor(P).sysexIndex + (L == Rev2Layer::B ? kSysexStartLayerB : 0);
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static constexpr int nrpn() {
+			return descriptor(P).nrpn + (L == Rev2Layer::B ? kNRPNStartLayerB : 0);
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static uint8 get(Synth::PatchData const &data) {
+			static_assert(!descriptor(P).isArray(), "Array parameters need a step");
+			return data[sysexIndex<P, L>()];
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static uint8 get(DataFile const &patch) {
+			return get<P, L>(patch.data());
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static uint8 get(Synth::PatchData const &data, int step) {
+			static_assert(descriptor(P).isArray(), "Only array parameters have steps");
+			jassert(step >= 0 && step < descriptor(P).length());
+			return data[sysexIndex<P, L>() + step];
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static void set(DataFile &patch, uint8 value) {
+			static_assert(!descriptor(P).isArray(), "Array parameters need a step");
+			patch.setAt(sysexIndex<P, L>(), value);
+		}
+
+		template<Rev2Param P, Rev2Layer L = Rev2Layer::A>
+		static void set(DataFile &patch, int step, uint8 value) {
+			static_assert(descriptor(P).isArray(), "Only array parameters have steps");
+			jassert(step >= 0 && step < descriptor(P).length());
+			patch.setAt(sysexIndex<P, L>() + step, value);
+		}
+
+		// Runtime mapping between NRPN numbers and sysex indexes, both including the layer B offsets. Return -1 if unknown
+		static int sysexIndexForNRPN(int nrpn);
+		static int nrpnForSysexIndex(int sysexIndex);
+		// Returns nullptr if the NRPN number (of either layer) is not a known parameter
+		static Rev2ParamDescriptor const *findByNRPN(int nrpn);
+		// The CC number for the parameter with the given NRPN number (without layer offset), or -1 if it has none
+		static int controllerForNRPN(int nrpn);
+	};
+
+}
@@ -19,6 +19,14 @@ namespace midikraft {
 	public:
 		Rev2Patch();
 		Rev2Patch(Synth::PatchData const &patchData, MidiProgramNumber programNo);
+		// Copies of a Rev2Patch share their data buffer until one of them is modified
+		Rev2Patch(Rev2Patch const &other) = default;
+
+		// Copy on write access to the patch data
+		virtual Synth::PatchData const &data() const override;
+		virtual int at(int sysExIndex) const override;
+		virtual void setAt(int sysExIndex, uint8 value) override;
+		virtual void setData(Synth::PatchData const &data) override;
 
 		virtual std::string name() const override;
 		virtual void setName(std::string const &name) override;
@@ -33,9 +41,19 @@ namespace midikraft {
 		virtual std::string layerName(int layerNo) const override;
 		virtual void setLayerName(int layerNo, std::string const &layerName) override;
 
+		// The same on raw patch data of 2048 bytes, for containers that don't keep a Rev2Patch per program
+		static std::string nameOf(const uint8 *data);
+		static std::string layerNameOf(const uint8 *data, int layerNo);
+		static LayerMode layerModeOf(const uint8 *data);
+
 		static std::shared_ptr<Rev2ParamDefinition> find(std::string const &paramID);
+		// The shared, immutable parameter definitions. Use the layer explicit functions of Rev2ParamDefinition on these
+		static std::vector<Rev2ParamDefinition> const &parameterDefinitions();
 
 	private:
+		Synth::PatchData &writableData();
+
+		std::shared_ptr<Synth::PatchData const> sharedData_;
 		MidiProgramNumber number_;
 	};
 
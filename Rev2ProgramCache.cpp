@@ -0,0 +1,135 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2ProgramCache.h"
+
+#include "Rev2Patch.h"
+
+namespace midikraft {
+
+	Rev2ProgramCache::Rev2ProgramCache() : currentBank_(0), currentProgram_(-1), editedSinceProgramChange_(false), hits_(0), misses_(0)
+	{
+	}
+
+	void Rev2ProgramCache::store(MidiProgramNumber place, Synth::PatchData const &data)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		programs_[place.toZeroBased()] = std::make_shared<Rev2Patch>(data, place);
+	}
+
+	void Rev2ProgramCache::invalidate(MidiProgramNumber place)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		programs_.erase(place.toZeroBased());
+	}
+
+	void Rev2ProgramCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		programs_.clear();
+	}
+
+	std::shared_ptr<DataFile> Rev2ProgramCache::lookup(MidiProgramNumber place)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return lookupLocked(place.toZeroBased());
+	}
+
+	std::shared_ptr<DataFile> Rev2ProgramCache::lookupLocked(int place)
+	{
+		auto found = programs_.find(place);
+		if (found == programs_.end()) {
+			misses_++;
+			return nullptr;
+		}
+		hits_++;
+		return std::make_shared<Rev2Patch>(*found->second);
+	}
+
+	void Rev2ProgramCache::observeMessage(MidiMessage const &message)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (message.isController()) {
+			int controller = message.getControllerNumber();
+			if (controller == 0 || controller == 32) {
+				// The Rev2 accepts bank select on either MSB or LSB, the value is the bank 0 to 7 (U1 to F4)
+				currentBank_ = message.getControllerValue() % 8;
+			}
+			else if (isEditingController(controller)) {
+				editedSinceProgramChange_ = true;
+			}
+		}
+		else if (message.isProgramChange()) {
+			currentProgram_ = currentBank_ * 128 + message.getProgramChangeNumber();
+			editedSinceProgramChange_ = false;
+		}
+	}
+
+	void Rev2ProgramCache::editBufferChanged()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		editedSinceProgramChange_ = true;
+	}
+
+	void Rev2ProgramCache::storeAsCurrentProgram(Synth::PatchData const &editBuffer)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (currentProgram_ != -1 && !editedSinceProgramChange_) {
+			programs_[currentProgram_] = std::make_shared<Rev2Patch>(editBuffer, MidiProgramNumber::fromZeroBase(currentProgram_));
+		}
+	}
+
+	bool Rev2ProgramCache::knowsCurrentProgram() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return currentProgram_ != -1;
+	}
+
+	MidiProgramNumber Rev2ProgramCache::currentProgram() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return MidiProgramNumber::fromZeroBase(currentProgram_ == -1 ? 0 : currentProgram_);
+	}
+
+	std::shared_ptr<DataFile> Rev2ProgramCache::currentProgramPatch()
+	{
+		// Program and edit state must be read together with the map, else a program change in between returns the wrong patch
+		std::lock_guard<std::mutex> lock(lock_);
+		if (currentProgram_ == -1 || editedSinceProgramChange_) {
+			misses_++;
+			return nullptr;
+		}
+		return lookupLocked(currentProgram_);
+	}
+
+	Rev2ProgramCache::Statistics Rev2ProgramCache::statistics() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		Statistics result;
+		result.hits = hits_;
+		result.misses = misses_;
+		result.entries = programs_.size();
+		return result;
+	}
+
+	bool Rev2ProgramCache::isEditingController(int controllerNumber) const
+	{
+		switch (controllerNumber) {
+		case 1: // Mod Wheel
+		case 2: // Breath
+		case 4: // Foot
+		case 7: // Volume
+		case 11: // Expression
+		case 64: // Sustain
+			// Performance controllers, they don't change the edit buffer
+			return false;
+		default:
+			// Channel mode messages don't touch the program either
+			return controllerNumber < 120;
+		}
+	}
+
+}
@@ -0,0 +1,67 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Patch.h"
+
+#include <mutex>
+
+namespace midikraft {
+
+	class Rev2Patch;
+
+	// Keeps the program dumps we have seen from the Rev2, so the current program can be resolved after a program change
+	// without asking the synth for its edit buffer again. Entries are snapshots of the patch data, edits to patches
+	// in the librarian do not leak into the cache. As Rev2Patch data is copy on write, a cache hit does not copy the data.
+	class Rev2ProgramCache {
+	public:
+		struct Statistics {
+			uint64 hits = 0;
+			uint64 misses = 0;
+			size_t entries = 0;
+
+			double hitRate() const { return hits + misses > 0 ? hits / (double)(hits + misses) : 0.0; }
+		};
+
+		Rev2ProgramCache();
+
+		void store(MidiProgramNumber place, Synth::PatchData const &data);
+		void invalidate(MidiProgramNumber place);
+		void clear();
+
+		// Returns nullptr if the program is not known
+		std::shared_ptr<DataFile> lookup(MidiProgramNumber place);
+
+		// Feed all MIDI messages received from the synth in here, to follow bank select, program changes, and edits done on the synth
+		void observeMessage(MidiMessage const &message);
+		// Call this when the edit buffer is changed by us, e.g. by sending NRPN messages or an edit buffer dump
+		void editBufferChanged();
+		// An edit buffer received right after a program change is the stored program, so it can be used to fill the cache
+		void storeAsCurrentProgram(Synth::PatchData const &editBuffer);
+
+		bool knowsCurrentProgram() const;
+		MidiProgramNumber currentProgram() const;
+		// Returns nullptr if the program is unknown, not cached, or was edited since the program change
+		std::shared_ptr<DataFile> currentProgramPatch();
+
+		Statistics statistics() const;
+
+	private:
+		bool isEditingController(int controllerNumber) const;
+		// Caller must hold lock_
+		std::shared_ptr<DataFile> lookupLocked(int place);
+
+		mutable std::mutex lock_;
+		std::map<int, std::shared_ptr<Rev2Patch>> programs_;
+		int currentBank_;
+		int currentProgram_; // -1 means we have not seen a program change yet
+		bool editedSinceProgramChange_;
+		uint64 hits_;
+		uint64 misses_;
+	};
+
+}
@@ -0,0 +1,142 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2SequenceLock.h"
+
+#include "Logger.h"
+
+#include <boost/format.hpp>
+
+namespace midikraft {
+
+	void Rev2SequenceLock::Timing::record(double ms)
+	{
+		lastMs = ms;
+		minMs = count == 0 ? ms : std::min(minMs, ms);
+		maxMs = count == 0 ? ms : std::max(maxMs, ms);
+		totalMs += ms;
+		count++;
+	}
+
+	Rev2SequenceLock::Rev2SequenceLock(std::shared_ptr<Rev2> rev2) : rev2_(rev2), isLocked_(false), programChangeTime_(-1.0)
+	{
+	}
+
+	void Rev2SequenceLock::lock(MidiMessage const &editBufferDump)
+	{
+		auto splice = rev2_->prepareSequencerSplice(editBufferDump);
+		std::lock_guard<std::mutex> lock(lock_);
+		splice_ = splice;
+		isLocked_ = true;
+	}
+
+	void Rev2SequenceLock::unlock()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		isLocked_ = false;
+	}
+
+	bool Rev2SequenceLock::isLocked() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return isLocked_;
+	}
+
+	bool Rev2SequenceLock::handleIncomingMessage(MidiMessage const &message)
+	{
+		auto cache = rev2_->programCache();
+		cache->observeMessage(message);
+
+		if (message.isProgramChange()) {
+			double programChangeTime = Time::getMillisecondCounterHiRes();
+			auto cachedPatch = cache->currentProgramPatch();
+			if (!cachedPatch) {
+				{
+					std::lock_guard<std::mutex> lock(lock_);
+					programChangeTime_ = programChangeTime;
+				}
+				rev2_->sendToSynth({ rev2_->requestEditBufferDump() });
+				return false;
+			}
+
+			// We already know the program, e.g. from a bank load, no need to ask the synth for it
+			std::unique_lock<std::mutex> lock(lock_);
+			programChangeTime_ = -1.0;
+			if (!isLocked_) {
+				currentPatch_ = cachedPatch;
+				return false;
+			}
+			auto splice = splice_;
+			lock.unlock();
+			auto patchedBack = rev2_->spliceSequencers(rev2_->patchToSysex(cachedPatch)[0], splice);
+			rev2_->sendToSynth({ patchedBack });
+			restored(patchedBack, Time::getMillisecondCounterHiRes() - programChangeTime, "cached program");
+			return false;
+		}
+
+		if (!rev2_->isEditBufferDump(message)) {
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock(lock_);
+		if (programChangeTime_ < 0.0) {
+			// Not asked for by us
+			return false;
+		}
+		double programChangeTime = programChangeTime_;
+		programChangeTime_ = -1.0;
+		bool isLocked = isLocked_;
+		auto splice = splice_;
+		lock.unlock();
+
+		if (!isLocked) {
+			auto patch = rev2_->patchFromSysex(message);
+			cache->storeAsCurrentProgram(patch->data());
+			lock.lock();
+			currentPatch_ = patch;
+			return true;
+		}
+
+		// Send first, the old sequence is audible until the synth has the patched edit buffer
+		auto patchedBack = rev2_->spliceSequencers(message, splice);
+		rev2_->sendToSynth({ patchedBack });
+		double elapsedMs = Time::getMillisecondCounterHiRes() - programChangeTime;
+		// The unpatched edit buffer is the stored program, remember it for the next time
+		cache->storeAsCurrentProgram(rev2_->patchFromSysex(message)->data());
+		restored(patchedBack, elapsedMs, "requested edit buffer");
+		return true;
+	}
+
+	void Rev2SequenceLock::restored(MidiMessage const &patchedBack, double elapsedMs, const char *source)
+	{
+		// The synth now plays something that is not the stored program
+		rev2_->programCache()->editBufferChanged();
+		auto patch = rev2_->patchFromSysex(patchedBack);
+
+		double averageMs;
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			timing_.record(elapsedMs);
+			currentPatch_ = patch;
+			averageMs = timing_.averageMs();
+		}
+		SimpleLogger::instance()->postMessage((boost::format("Program change - Restored all sequences from locked data using the %s in %.1f ms (average %.1f ms)")
+			% source % elapsedMs % averageMs).str());
+	}
+
+	std::shared_ptr<DataFile> Rev2SequenceLock::currentPatch() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return currentPatch_;
+	}
+
+	Rev2SequenceLock::Timing Rev2SequenceLock::restoreTiming() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return timing_;
+	}
+
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Rev2.h"
+
+#include <mutex>
+
+namespace midikraft {
+
+	// Makes the poly and gated sequences of a locked program survive program changes on the Rev2. Feed it all MIDI messages
+	// received from the synth, they also go to the Rev2's program cache. On a program change, the new program is taken from the
+	// cache if possible. Only on a miss the edit buffer is requested, and the reply fills the cache. The locked sequences are
+	// spliced into the still escaped dump and sent back, before anything is decoded. It also keeps track of the patch the synth plays.
+	class Rev2SequenceLock {
+	public:
+		// Time from receiving the program change to sending out the edit buffer with the restored sequences, in milliseconds
+		struct Timing {
+			int count = 0;
+			double lastMs = 0.0;
+			double minMs = 0.0;
+			double maxMs = 0.0;
+			double totalMs = 0.0;
+
+			void record(double ms);
+			double averageMs() const { return count > 0 ? totalMs / count : 0.0; }
+		};
+
+		Rev2SequenceLock(std::shared_ptr<Rev2> rev2);
+
+		// Takes the sequences from this edit buffer dump, the expensive part of the splice is done once here
+		void lock(MidiMessage const &editBufferDump);
+		void unlock();
+		bool isLocked() const;
+
+		// Returns true if the message was the edit buffer this class asked for, and should not be handled by anybody else
+		bool handleIncomingMessage(MidiMessage const &message);
+
+		// The patch the synth plays since the last program change, including restored sequences. nullptr if not known yet
+		std::shared_ptr<DataFile> currentPatch() const;
+		Timing restoreTiming() const;
+
+	private:
+		// Bookkeeping after the patched edit buffer was sent
+		void restored(MidiMessage const &patchedBack, double elapsedMs, const char *source);
+
+		std::shared_ptr<Rev2> rev2_;
+		mutable std::mutex lock_;
+		bool isLocked_;
+		Rev2::SequencerSplice splice_;
+		double programChangeTime_; // Negative while no edit buffer is awaited
+		std::shared_ptr<DataFile> currentPatch_;
+		Timing timing_;
+	};
+
+}
@@ -0,0 +1,142 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2Trace.h"
+
+#include <sstream>
+#include <thread>
+
+namespace midikraft {
+
+	const size_t kDefaultTraceCapacity = 65536;
+
+	Rev2Trace & Rev2Trace::instance()
+	{
+		static Rev2Trace sInstance;
+		return sInstance;
+	}
+
+	Rev2Trace::Rev2Trace() : enabled_(false), wasEverEnabled_(false), writeIndex_(0), capacity_(0), originTicks_(Time::getHighResolutionTicks())
+	{
+		setCapacity(kDefaultTraceCapacity);
+	}
+
+	void Rev2Trace::setEnabled(bool enabled)
+	{
+		if (enabled) {
+			std::lock_guard<std::mutex> lock(exportLock_);
+			wasEverEnabled_ = true;
+		}
+		enabled_.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool Rev2Trace::setCapacity(size_t numberOfEvents)
+	{
+		std::lock_guard<std::mutex> lock(exportLock_);
+		if (wasEverEnabled_) {
+			// A span started before tracing was disabled would write into the freed buffer
+			jassert(false);
+			return false;
+		}
+		capacity_ = std::max(numberOfEvents, (size_t) 1);
+		events_.reset(new Event[capacity_]);
+		for (size_t i = 0; i < capacity_; i++) {
+			events_[i].sequence.store(0, std::memory_order_relaxed);
+		}
+		writeIndex_.store(0, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Rev2Trace::clear()
+	{
+		std::lock_guard<std::mutex> lock(exportLock_);
+		for (size_t i = 0; i < capacity_; i++) {
+			events_[i].sequence.store(0, std::memory_order_relaxed);
+		}
+		writeIndex_.store(0, std::memory_order_relaxed);
+	}
+
+	void Rev2Trace::recordSpan(const char *name, const char *category, int64 startTicks, int64 endTicks, int64 argument)
+	{
+		record(name, category, startTicks, endTicks - startTicks, argument);
+	}
+
+	void Rev2Trace::recordInstant(const char *name, const char *category, int64 argument)
+	{
+		if (isEnabled()) {
+			record(name, category, Time::getHighResolutionTicks(), -1, argument);
+		}
+	}
+
+	void Rev2Trace::record(const char *name, const char *category, int64 startTicks, int64 durationTicks, int64 argument)
+	{
+		// Each writer gets its own slot, the sequence number tells the exporter whether the slot is complete
+		uint64 index = writeIndex_.fetch_add(1, std::memory_order_relaxed);
+		Event &event = events_[index % capacity_];
+		event.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		event.name = name;
+		event.category = category;
+		event.startTicks = startTicks;
+		event.durationTicks = durationTicks;
+		event.argument = argument;
+		event.threadId = (uint32) std::hash<std::thread::id>()(std::this_thread::get_id());
+		event.sequence.store(index + 1, std::memory_order_release);
+	}
+
+	std::string Rev2Trace::toChromeTraceJson() const
+	{
+		std::stringstream result;
+		writeChromeTrace(result);
+		return result.str();
+	}
+
+	void Rev2Trace::writeChromeTrace(std::ostream &out) const
+	{
+		std::lock_guard<std::mutex> lock(exportLock_);
+		double ticksPerMicrosecond = Time::getHighResolutionTicksPerSecond() / 1000000.0;
+		uint64 end = writeIndex_.load(std::memory_order_acquire);
+		uint64 start = end > capacity_ ? end - capacity_ : 0;
+		out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+		bool first = true;
+		for (uint64 index = start; index < end; index++) {
+			Event const &event = events_[index % capacity_];
+			if (event.sequence.load(std::memory_order_acquire) != index + 1) {
+				// Still being written, or already overwritten by a newer event
+				continue;
+			}
+			const char *name = event.name;
+			const char *category = event.category;
+			int64 startTicks = event.startTicks;
+			int64 durationTicks = event.durationTicks;
+			int64 argument = event.argument;
+			uint32 threadId = event.threadId;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (event.sequence.load(std::memory_order_relaxed) != index + 1) {
+				continue;
+			}
+
+			out << (first ? "\n" : ",\n");
+			first = false;
+			out << "  { \"name\": \"" << name << "\", \"cat\": \"" << category << "\""
+				<< ", \"ph\": \"" << (durationTicks < 0 ? "i" : "X") << "\""
+				<< ", \"ts\": " << (startTicks - originTicks_) / ticksPerMicrosecond;
+			if (durationTicks >= 0) {
+				out << ", \"dur\": " << durationTicks / ticksPerMicrosecond;
+			}
+			else {
+				out << ", \"s\": \"t\"";
+			}
+			out << ", \"pid\": 1, \"tid\": " << threadId;
+			if (argument != -1) {
+				out << ", \"args\": { \"item\": " << argument << " }";
+			}
+			out << " }";
+		}
+		out << "\n] }\n";
+	}
+
+}
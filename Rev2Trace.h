@@ -0,0 +1,83 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace midikraft {
+
+	// Timeline recorder for the Rev2 operations. Spans are written into a fixed size ring buffer, so a long running
+	// session keeps the most recent events only. The result can be exported in the Chrome trace event format
+	// and opened in chrome://tracing or https://ui.perfetto.dev.
+	// When tracing is switched off, a span costs one relaxed atomic load.
+	class Rev2Trace {
+	public:
+		static Rev2Trace &instance();
+
+		void setEnabled(bool enabled);
+		bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+		// The capacity can only be changed before tracing is enabled for the first time, as spans in flight keep writing into the
+		// buffer even after tracing was disabled again. This clears all recorded events, returns false if it was too late
+		bool setCapacity(size_t numberOfEvents);
+		void clear();
+
+		// Name and category must be string literals or otherwise outlive the trace, they are not copied
+		void recordSpan(const char *name, const char *category, int64 startTicks, int64 endTicks, int64 argument);
+		void recordInstant(const char *name, const char *category, int64 argument);
+
+		std::string toChromeTraceJson() const;
+		void writeChromeTrace(std::ostream &out) const;
+
+	private:
+		struct Event {
+			std::atomic<uint64> sequence; // 0 while being written, otherwise write index + 1
+			const char *name;
+			const char *category;
+			int64 startTicks;
+			int64 durationTicks; // -1 for instant events
+			int64 argument; // -1 means no argument
+			uint32 threadId;
+		};
+
+		Rev2Trace();
+
+		void record(const char *name, const char *category, int64 startTicks, int64 durationTicks, int64 argument);
+
+		std::atomic<bool> enabled_;
+		bool wasEverEnabled_; // Guarded by exportLock_, the event buffer is fixed once this is set
+		std::atomic<uint64> writeIndex_;
+		std::unique_ptr<Event[]> events_;
+		size_t capacity_;
+		int64 originTicks_;
+		mutable std::mutex exportLock_;
+	};
+
+	// Records the lifetime of this object as one span, if tracing is enabled at construction time
+	class Rev2TraceSpan {
+	public:
+		Rev2TraceSpan(const char *name, int64 argument = -1, const char *category = "rev2") :
+			name_(name), category_(category), argument_(argument), active_(Rev2Trace::instance().isEnabled()), startTicks_(active_ ? Time::getHighResolutionTicks() : 0) {}
+
+		~Rev2TraceSpan() {
+			if (active_) {
+				Rev2Trace::instance().recordSpan(name_, category_, startTicks_, Time::getHighResolutionTicks(), argument_);
+			}
+		}
+
+	private:
+		const char *name_;
+		const char *category_;
+		int64 argument_;
+		bool active_;
+		int64 startTicks_;
+	};
+
+}
@@ -0,0 +1,166 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2TrafficCapture.h"
+
+#include "Rev2.h"
+#include "Rev2NrpnReceiver.h"
+#include "Rev2ProgramCache.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace midikraft {
+
+	const char kCaptureMagic[] = { 'R', '2', 'C', 'A', 'P', 1 };
+
+	static void writeVarint(std::ostream &out, uint64 value)
+	{
+		while (value >= 0x80) {
+			out.put((char)((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		out.put((char)value);
+	}
+
+	static bool readVarint(std::istream &in, uint64 &outValue)
+	{
+		outValue = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			int byte = in.get();
+			if (byte == std::char_traits<char>::eof()) return false;
+			outValue |= (uint64)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) return true;
+		}
+		return false;
+	}
+
+	Rev2TrafficCapture::~Rev2TrafficCapture()
+	{
+		stop();
+	}
+
+	bool Rev2TrafficCapture::start(std::string const &filename)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (out_.is_open()) {
+			out_.close();
+		}
+		out_.open(filename, std::ios::binary | std::ios::trunc);
+		if (!out_) {
+			SimpleLogger::instance()->postMessage("Error: Could not open MIDI capture file " + filename);
+			return false;
+		}
+		out_.write(kCaptureMagic, sizeof(kCaptureMagic));
+		startTime_ = Time::getMillisecondCounterHiRes();
+		lastMicroseconds_ = 0;
+		return true;
+	}
+
+	void Rev2TrafficCapture::stop()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (out_.is_open()) {
+			out_.close();
+		}
+	}
+
+	bool Rev2TrafficCapture::isCapturing() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return out_.is_open();
+	}
+
+	void Rev2TrafficCapture::record(Direction direction, MidiMessage const &message)
+	{
+		record(direction, message.getRawData(), (size_t)message.getRawDataSize());
+	}
+
+	void Rev2TrafficCapture::record(Direction direction, const uint8 *data, size_t length)
+	{
+		double now = Time::getMillisecondCounterHiRes();
+		std::lock_guard<std::mutex> lock(lock_);
+		if (!out_.is_open()) return;
+		// Messages from different threads might arrive out of order by a few microseconds, the delta never goes negative
+		uint64 microseconds = std::max(lastMicroseconds_, (uint64)std::max(0.0, (now - startTime_) * 1000.0));
+		out_.put((char)direction);
+		writeVarint(out_, microseconds - lastMicroseconds_);
+		writeVarint(out_, length);
+		out_.write(reinterpret_cast<const char *>(data), (std::streamsize)length);
+		lastMicroseconds_ = microseconds;
+	}
+
+	std::vector<Rev2TrafficCapture::Event> Rev2TrafficCapture::load(std::string const &filename)
+	{
+		std::vector<Event> result;
+		std::ifstream in(filename, std::ios::binary);
+		char magic[sizeof(kCaptureMagic)];
+		if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kCaptureMagic)) {
+			SimpleLogger::instance()->postMessage("Error: " + filename + " is not a Rev2 MIDI capture");
+			return result;
+		}
+		uint64 microseconds = 0;
+		while (true) {
+			int direction = in.get();
+			uint64 delta, length;
+			if (direction == std::char_traits<char>::eof() || !readVarint(in, delta) || !readVarint(in, length)) break;
+			Event event;
+			event.direction = direction == 0 ? Direction::IN : Direction::OUT;
+			microseconds += delta;
+			event.timeMs = microseconds / 1000.0;
+			event.bytes.resize((size_t)length);
+			if (!in.read(reinterpret_cast<char *>(event.bytes.data()), (std::streamsize)length)) {
+				SimpleLogger::instance()->postMessage("Warning: MIDI capture " + filename + " is truncated");
+				break;
+			}
+			result.push_back(std::move(event));
+		}
+		return result;
+	}
+
+	Rev2TrafficReplay::Rev2TrafficReplay(std::vector<Rev2TrafficCapture::Event> events) : events_(std::move(events))
+	{
+	}
+
+	Rev2TrafficReplay::Result Rev2TrafficReplay::run(Handler const &handler, double speed /* = 1.0 */) const
+	{
+		Result result;
+		double startTime = Time::getMillisecondCounterHiRes();
+		for (auto const &event : events_) {
+			if (event.bytes.empty()) continue;
+			if (speed > 0.0) {
+				double scheduled = startTime + event.timeMs / speed;
+				double now = Time::getMillisecondCounterHiRes();
+				if (scheduled > now) {
+					std::this_thread::sleep_for(std::chrono::microseconds((int64)((scheduled - now) * 1000.0)));
+				}
+				else {
+					result.maxLateMs = std::max(result.maxLateMs, now - scheduled);
+				}
+			}
+			MidiMessage message(event.bytes.data(), (int)event.bytes.size());
+			handler(event.direction, message);
+			if (event.direction == Rev2TrafficCapture::Direction::IN) result.messagesIn++; else result.messagesOut++;
+		}
+		result.milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+		return result;
+	}
+
+	Rev2TrafficReplay::Handler Rev2TrafficReplay::feedToRev2(std::shared_ptr<Rev2> rev2, Rev2NrpnReceiver *nrpnReceiver /* = nullptr */)
+	{
+		return [rev2, nrpnReceiver](Rev2TrafficCapture::Direction direction, MidiMessage const &message) {
+			if (direction != Rev2TrafficCapture::Direction::IN) return;
+			rev2->programCache()->observeMessage(message);
+			if (rev2->isSingleProgramDump(message) || rev2->isEditBufferDump(message)) {
+				rev2->patchFromSysex(message);
+			}
+			if (nrpnReceiver) {
+				nrpnReceiver->handleIncomingMessage(message);
+			}
+		};
+	}
+
+}
@@ -0,0 +1,79 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <fstream>
+#include <functional>
+#include <mutex>
+
+namespace midikraft {
+
+	class Rev2;
+	class Rev2NrpnReceiver;
+
+	// Records all MIDI messages to and from a Rev2 with their timing, so problems seen in the field can be replayed at a desk.
+	// The file starts with "R2CAP" and a version byte 1, then one record per message:
+	//   uint8 direction (0 = in, 1 = out), varint microseconds since the previous record, varint length, the message bytes
+	// Varints are 7 bits per byte, least significant group first, with the high bit set on all bytes but the last.
+	class Rev2TrafficCapture {
+	public:
+		enum class Direction : uint8 { IN = 0, OUT = 1 };
+
+		struct Event {
+			Direction direction;
+			double timeMs; // Since the start of the capture
+			std::vector<uint8> bytes;
+		};
+
+		~Rev2TrafficCapture();
+
+		bool start(std::string const &filename);
+		void stop();
+		bool isCapturing() const;
+
+		// Thread safe, called from the send functions of the synth and the MIDI input callbacks
+		void record(Direction direction, MidiMessage const &message);
+		void record(Direction direction, const uint8 *data, size_t length);
+
+		// Returns an empty list if the file can't be read or is not a capture
+		static std::vector<Event> load(std::string const &filename);
+
+	private:
+		mutable std::mutex lock_;
+		std::ofstream out_;
+		double startTime_ = 0.0;
+		uint64 lastMicroseconds_ = 0;
+	};
+
+	// Plays a capture back with its original timing, or faster. Only the incoming messages are interesting for the Rev2 classes,
+	// the outgoing ones are passed to the handler too, e.g. to compare with what the code sends today.
+	class Rev2TrafficReplay {
+	public:
+		typedef std::function<void(Rev2TrafficCapture::Direction, MidiMessage const &)> Handler;
+
+		struct Result {
+			size_t messagesIn = 0;
+			size_t messagesOut = 0;
+			double milliseconds = 0.0;
+			double maxLateMs = 0.0; // How far the replay fell behind the scheduled time of a message
+		};
+
+		Rev2TrafficReplay(std::vector<Rev2TrafficCapture::Event> events);
+
+		// speed 1.0 is the original timing, 10.0 ten times as fast, and 0.0 as fast as possible without waiting
+		Result run(Handler const &handler, double speed = 1.0) const;
+
+		// Feeds the incoming messages through the Rev2 like the host would: the program cache, patch decoding, and optionally the NRPN receiver
+		static Handler feedToRev2(std::shared_ptr<Rev2> rev2, Rev2NrpnReceiver *nrpnReceiver = nullptr);
+
+	private:
+		std::vector<Rev2TrafficCapture::Event> events_;
+	};
+
+}
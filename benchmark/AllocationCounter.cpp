@@ -0,0 +1,130 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+static std::atomic<uint64_t> sAllocations(0);
+
+uint64_t AllocationCounter::total()
+{
+	return sAllocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+	sAllocations.fetch_add(1, std::memory_order_relaxed);
+	void *memory = std::malloc(size > 0 ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+	sAllocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+// Over-aligned types (alignas larger than the default new alignment) go through these, count them as well
+static void *alignedAllocate(std::size_t size, std::align_val_t alignment) noexcept
+{
+	sAllocations.fetch_add(1, std::memory_order_relaxed);
+	std::size_t alignBytes = static_cast<std::size_t>(alignment);
+	// aligned_alloc wants a multiple of the alignment as size
+	std::size_t rounded = ((size > 0 ? size : 1) + alignBytes - 1) / alignBytes * alignBytes;
+#ifdef _MSC_VER
+	return _aligned_malloc(rounded, alignBytes);
+#else
+	return std::aligned_alloc(alignBytes, rounded);
+#endif
+}
+
+static void alignedFree(void *memory) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+	void *memory = alignedAllocate(size, alignment);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const &) noexcept
+{
+	return alignedAllocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const &) noexcept
+{
+	return alignedAllocate(size, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+	alignedFree(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+	alignedFree(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(memory);
+}
@@ -0,0 +1,27 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// Counts the calls to the global operator new of the benchmark executable, which replaces it in AllocationCounter.cpp.
+// Used to check that the hot paths don't allocate:
+//
+//   AllocationCounter counter;
+//   rev2->friendlyProgramName(place);
+//   if (counter.allocations() != 0) ...
+class AllocationCounter {
+public:
+	AllocationCounter() : start_(total()) {}
+
+	uint64_t allocations() const { return total() - start_; }
+
+	static uint64_t total();
+
+private:
+	uint64_t start_;
+};
@@ -0,0 +1,108 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Minimal benchmark runner. Each benchmark is run in batches until the minimum time is spent, and the results
+// are written as JSON so runs of different releases can be compared by a script.
+class BenchmarkSuite {
+public:
+	struct Result {
+		std::string name;
+		uint64_t iterations;
+		double nsPerOp; // Average over all batches
+		double bestNsPerOp; // Fastest batch, least disturbed by the rest of the system
+		int itemsPerOp; // e.g. 128 for loading a bank, so throughput can be calculated per patch
+	};
+
+	BenchmarkSuite(double minSecondsPerBenchmark, std::string const &filter) : minSeconds_(minSecondsPerBenchmark), filter_(filter) {}
+
+	template <typename Operation>
+	void run(std::string const &name, Operation &&operation, int itemsPerOp = 1) {
+		if (!filter_.empty() && name.find(filter_) == std::string::npos) return;
+
+		// Warm up, and find a batch size that is long enough to be measured reliably
+		operation();
+		uint64_t batchSize = 1;
+		while (batchSize < (1ull << 30)) {
+			double seconds = timeBatch(operation, batchSize);
+			if (seconds > 0.01) break;
+			batchSize *= 2;
+		}
+
+		Result result = { name, 0, 0.0, 0.0, itemsPerOp };
+		double totalSeconds = 0.0;
+		double bestSeconds = -1.0;
+		while (totalSeconds < minSeconds_ || result.iterations == 0) {
+			double seconds = timeBatch(operation, batchSize);
+			totalSeconds += seconds;
+			result.iterations += batchSize;
+			if (bestSeconds < 0.0 || seconds < bestSeconds) bestSeconds = seconds;
+		}
+		result.nsPerOp = totalSeconds * 1e9 / result.iterations;
+		result.bestNsPerOp = bestSeconds * 1e9 / batchSize;
+		results_.push_back(result);
+	}
+
+	std::vector<Result> const &results() const { return results_; }
+
+	void writeJson(std::ostream &out, std::string const &suiteName, std::string const &corpus) const {
+		out << "{\n";
+		out << "  \"suite\": \"" << suiteName << "\",\n";
+		out << "  \"corpus\": \"" << escapeJson(corpus) << "\",\n";
+		out << "  \"results\": [\n";
+		for (size_t i = 0; i < results_.size(); i++) {
+			auto const &r = results_[i];
+			out << "    { \"name\": \"" << escapeJson(r.name) << "\""
+				<< ", \"iterations\": " << r.iterations
+				<< ", \"ns_per_op\": " << r.nsPerOp
+				<< ", \"best_ns_per_op\": " << r.bestNsPerOp
+				<< ", \"items_per_op\": " << r.itemsPerOp
+				<< ", \"ops_per_second\": " << (r.nsPerOp > 0.0 ? 1e9 / r.nsPerOp : 0.0)
+				<< " }" << (i + 1 < results_.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n";
+		out << "}\n";
+	}
+
+	// Make sure the compiler can't optimize away the result of the measured operation
+	template <typename T>
+	static void keep(T const &value) {
+		sink_ = &value;
+	}
+
+private:
+	template <typename Operation>
+	static double timeBatch(Operation &operation, uint64_t batchSize) {
+		auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < batchSize; i++) {
+			operation();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(end - start).count();
+	}
+
+	static std::string escapeJson(std::string const &text) {
+		std::string result;
+		for (char c : text) {
+			if (c == '"' || c == '\\') result.push_back('\\');
+			result.push_back(c);
+		}
+		return result;
+	}
+
+	static inline void const * volatile sink_ = nullptr;
+
+	double minSeconds_;
+	std::string filter_;
+	std::vector<Result> results_;
+};
@@ -0,0 +1,287 @@
+/*
+   Copyright (c) 2019 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BenchmarkSuite.h"
+#include "AllocationCounter.h"
+
+#include "Rev2.h"
+#include "Rev2Patch.h"
+#include "Rev2ParamDefinition.h"
+#include "Rev2BankValidator.h"
+#include "Rev2BCR2000.h"
+#include "Rev2LibraryExporter.h"
+#include "Rev2NameIndex.h"
+#include "Rev2NrpnReceiver.h"
+#include "Rev2ParamLayout.h"
+#include "Rev2TrafficCapture.h"
+
+#include "Sysex.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace midikraft;
+
+// The escaping functions are protected in the DSISynth, make them available for the measurements
+class BenchmarkRev2 : public Rev2 {
+public:
+	using DSISynth::escapeSysex;
+	using DSISynth::unescapeSysex;
+	using DSISynth::unescapeSysexInto;
+};
+
+// Runs the listing, classification and decode paths, and reports every one that touches the heap.
+// The build runs this after linking the benchmark, so a change that adds an allocation fails the build.
+// patchFromSysex() and loadData() are not checked, their interface returns a new Rev2Patch with its own PatchData per
+// program. loadBank() is the allocation aware decode entry point, it may allocate its bank once, but not per program
+static int checkAllocations(BenchmarkRev2 &rev2, std::vector<MidiMessage> const &corpus, std::vector<Synth::PatchData> const &storedData)
+{
+	int failures = 0;
+	auto expectNoAllocations = [&failures](std::string const &name, auto &&operation) {
+		// Once to initialize the lookup tables, which is allowed to allocate
+		operation();
+		AllocationCounter counter;
+		operation();
+		if (counter.allocations() != 0) {
+			std::cerr << "FAILED: " << name << " made " << counter.allocations() << " heap allocations" << std::endl;
+			failures++;
+		}
+		else {
+			std::cout << "OK: " << name << std::endl;
+		}
+	};
+
+	size_t totalLength = 0;
+	expectNoAllocations("friendlyProgramName/1024", [&]() {
+		for (int place = 0; place < 1024; place++) {
+			totalLength += rev2.friendlyProgramName(MidiProgramNumber::fromZeroBase(place)).size();
+		}
+	});
+	expectNoAllocations("friendlyBankName/8", [&]() {
+		for (int bank = 0; bank < 8; bank++) {
+			totalLength += rev2.friendlyBankName(MidiBankNumber::fromZeroBase(bank)).size();
+		}
+	});
+	expectNoAllocations("getProgramNumber", [&]() {
+		for (auto const &message : corpus) {
+			totalLength += rev2.getProgramNumber(message).toZeroBased();
+		}
+	});
+	expectNoAllocations("isSingleProgramDump/isEditBufferDump", [&]() {
+		for (auto const &message : corpus) {
+			totalLength += rev2.isSingleProgramDump(message) + rev2.isEditBufferDump(message);
+		}
+	});
+	expectNoAllocations("classifyPatchData", [&]() {
+		for (auto const &data : storedData) {
+			totalLength += rev2.classifyPatchData(data.data(), data.size()).asInt();
+		}
+	});
+	// The bank itself is allocated once, so decoding 128 programs must cost the same number of allocations as decoding one
+	std::vector<MidiMessage> singleProgram(corpus.begin(), corpus.begin() + 1);
+	rev2.loadBank(singleProgram);
+	uint64_t allocationsForOne;
+	{
+		AllocationCounter counter;
+		BenchmarkSuite::keep(rev2.loadBank(singleProgram).size());
+		allocationsForOne = counter.allocations();
+	}
+	{
+		AllocationCounter counter;
+		BenchmarkSuite::keep(rev2.loadBank(corpus).size());
+		if (counter.allocations() != allocationsForOne) {
+			std::cerr << "FAILED: loadBank/" << corpus.size() << " made " << counter.allocations() << " heap allocations, loadBank/1 made " << allocationsForOne << std::endl;
+			failures++;
+		}
+		else {
+			std::cout << "OK: loadBank/" << corpus.size() << std::endl;
+		}
+	}
+	std::vector<uint8> decoded(2048);
+	expectNoAllocations("unescapeSysexInto+isValid", [&]() {
+		for (auto const &message : corpus) {
+			BenchmarkRev2::unescapeSysexInto(&message.getSysExData()[5], message.getSysExDataSize() - 5, decoded.data(), decoded.size());
+			totalLength += Rev2BankValidator::isValid(decoded.data());
+			totalLength += Rev2ParamLayout::get<Rev2Param::Cutoff, Rev2Layer::B>(decoded);
+		}
+	});
+	BenchmarkSuite::keep(totalLength);
+	return failures == 0 ? 0 : 1;
+}
+
+static void printUsage()
+{
+	std::cerr << "Usage: midikraft-sequential-rev2-benchmark [--corpus <file.syx>] [--output <results.json>] [--min-time <seconds>] [--filter <name>] [--replay <capture>] [--check-allocations]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string corpusFile = REV2_BENCHMARK_CORPUS;
+	std::string outputFile;
+	std::string filter;
+	std::string replayFile;
+	double minTime = 0.5;
+	bool checkOnly = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 < argc && arg == "--corpus") corpusFile = argv[++i];
+		else if (i + 1 < argc && arg == "--output") outputFile = argv[++i];
+		else if (i + 1 < argc && arg == "--min-time") minTime = std::stod(argv[++i]);
+		else if (i + 1 < argc && arg == "--filter") filter = argv[++i];
+		else if (i + 1 < argc && arg == "--replay") replayFile = argv[++i];
+		else if (arg == "--check-allocations") checkOnly = true;
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+
+	auto rev2 = std::make_shared<BenchmarkRev2>();
+	auto corpus = Sysex::loadSysex(corpusFile);
+	if (corpus.size() != 128 || !rev2->isSingleProgramDump(corpus[0])) {
+		std::cerr << "Corpus " << corpusFile << " is not a bank of 128 Rev2 program dumps" << std::endl;
+		return 1;
+	}
+
+	// Prepare the inputs, so the benchmarks measure only the operation itself
+	MidiMessage const &programDump = corpus[0];
+	const uint8 *escapedData = &programDump.getSysExData()[5];
+	int escapedLength = programDump.getSysExDataSize() - 5;
+	auto patch = rev2->patchFromSysex(programDump);
+	auto rev2Patch = std::dynamic_pointer_cast<Rev2Patch>(patch);
+	std::vector<std::shared_ptr<Rev2ParamDefinition>> parameters;
+	for (auto const &param : rev2Patch->allParameterDefinitions()) {
+		parameters.push_back(std::dynamic_pointer_cast<Rev2ParamDefinition>(param));
+	}
+
+	std::vector<Synth::PatchData> storedData;
+	std::vector<MidiProgramNumber> storedPlaces;
+	for (auto const &stored : rev2->loadData(corpus, DataStreamType(Rev2::PATCH_STREAM))) {
+		storedData.push_back(stored->data());
+		storedPlaces.push_back(MidiProgramNumber::fromZeroBase((int)storedPlaces.size()));
+	}
+	if (checkOnly) {
+		return checkAllocations(*rev2, corpus, storedData);
+	}
+
+	BenchmarkSuite suite(minTime, filter);
+	suite.run("escapeSysex", [&]() {
+		BenchmarkSuite::keep(BenchmarkRev2::escapeSysex(patch->data(), 2046));
+	});
+	suite.run("unescapeSysex", [&]() {
+		BenchmarkSuite::keep(BenchmarkRev2::unescapeSysex(escapedData, escapedLength, 2048));
+	});
+	std::vector<uint8> decodeBuffer(2048);
+	suite.run("unescapeSysexInto", [&]() {
+		BenchmarkSuite::keep(BenchmarkRev2::unescapeSysexInto(escapedData, escapedLength, decodeBuffer.data(), decodeBuffer.size()));
+	});
+	suite.run("patchFromSysex", [&]() {
+		BenchmarkSuite::keep(rev2->patchFromSysex(programDump));
+	});
+	suite.run("loadData/128", [&]() {
+		BenchmarkSuite::keep(rev2->loadData(corpus, DataStreamType(Rev2::PATCH_STREAM)));
+	}, 128);
+	suite.run("loadBank/128", [&]() {
+		BenchmarkSuite::keep(rev2->loadBank(corpus).size());
+	}, 128);
+	auto bank = rev2->loadBank(corpus);
+	suite.run("Rev2Bank::layerMode/128", [&]() {
+		int stacked = 0;
+		for (size_t i = 0; i < bank.size(); i++) {
+			stacked += bank[i].layerMode() == LayeredPatchCapability::STACK;
+		}
+		BenchmarkSuite::keep(stacked);
+	}, 128);
+	suite.run("patchesFromPatchData/128", [&]() {
+		BenchmarkSuite::keep(rev2->patchesFromPatchData(storedData, storedPlaces));
+	}, 128);
+	const size_t kValidationPatches = 100000;
+	std::vector<uint8> validationBank(kValidationPatches * Rev2BankValidator::kPatchSize);
+	for (size_t i = 0; i < kValidationPatches; i++) {
+		auto const &source = storedData[i % storedData.size()];
+		std::copy(source.begin(), source.end(), validationBank.begin() + i * Rev2BankValidator::kPatchSize);
+	}
+	suite.run("Rev2BankValidator::validateBank/100k", [&]() {
+		BenchmarkSuite::keep(Rev2BankValidator::validateBank(validationBank.data(), kValidationPatches));
+	}, (int)kValidationPatches);
+	Rev2NameIndex nameIndex;
+	for (size_t i = 0; i < kValidationPatches; i++) {
+		nameIndex.update(i, storedData[i % storedData.size()]);
+	}
+	suite.run("Rev2NameIndex::findSubstring/100k", [&]() {
+		BenchmarkSuite::keep(nameIndex.findSubstring("pad"));
+	});
+	suite.run("Rev2NameIndex::findPrefix/100k", [&]() {
+		BenchmarkSuite::keep(nameIndex.findPrefix("ba"));
+	});
+	suite.run("Rev2BCR2000::writeBCR/16 channels", [&]() {
+		std::ostringstream bcl;
+		for (int channel = 0; channel < 16; channel++) {
+			Rev2BCR2000::writeBCR(bcl, "Rev2", MidiChannel::fromZeroBase(channel), 1);
+		}
+		BenchmarkSuite::keep(bcl.str());
+	}, 16);
+	std::ostringstream generatedBCL;
+	Rev2BCR2000::writeBCR(generatedBCL, "Rev2", MidiChannel::fromZeroBase(0), 1);
+	suite.run("Rev2BCR2000::parseBCL+checkPresets", [&]() {
+		BenchmarkSuite::keep(Rev2BCR2000::checkPresets(Rev2BCR2000::parseBCL(generatedBCL.str()), MidiChannel::fromZeroBase(0)));
+	});
+	auto library = rev2->loadData(corpus, DataStreamType(Rev2::PATCH_STREAM));
+	Rev2LibraryExporter::Options csvWithText;
+	csvWithText.text = true;
+	suite.run("Rev2LibraryExporter::csvWithText/128", [&]() {
+		std::ostringstream exported;
+		BenchmarkSuite::keep(Rev2LibraryExporter::exportLibrary(library, exported, csvWithText).patchesExported);
+	}, 128);
+	Rev2LibraryExporter::Options binaryRaw;
+	binaryRaw.format = Rev2LibraryExporter::Format::BINARY;
+	suite.run("Rev2LibraryExporter::binaryRaw/128", [&]() {
+		std::ostringstream exported;
+		BenchmarkSuite::keep(Rev2LibraryExporter::exportLibrary(library, exported, binaryRaw).patchesExported);
+	}, 128);
+	if (!replayFile.empty()) {
+		// A capture from the field, fed through the Rev2 classes as fast as possible
+		Rev2TrafficReplay replay(Rev2TrafficCapture::load(replayFile));
+		auto replayRev2 = std::make_shared<Rev2>();
+		Rev2NrpnReceiver receiver;
+		auto handler = Rev2TrafficReplay::feedToRev2(replayRev2, &receiver);
+		size_t messages = replay.run([](Rev2TrafficCapture::Direction, MidiMessage const &) {}, 0.0).messagesIn;
+		suite.run("Rev2TrafficReplay::run", [&]() {
+			BenchmarkSuite::keep(replay.run(handler, 0.0).messagesIn);
+			receiver.processUpdates([](Rev2NrpnReceiver::Update const &) {});
+		}, (int)std::max((size_t)1, messages));
+	}
+	suite.run("layerToSysex", [&]() {
+		BenchmarkSuite::keep(rev2->layerToSysex(patch, 0, 1));
+	});
+	suite.run("layerToRawNRPN", [&]() {
+		BenchmarkSuite::keep(rev2->layerToRawNRPN(*patch, 0, 1));
+	});
+	suite.run("Rev2Patch::name", [&]() {
+		BenchmarkSuite::keep(rev2Patch->name());
+	});
+	suite.run("allParameterDefinitions", [&]() {
+		BenchmarkSuite::keep(rev2Patch->allParameterDefinitions());
+	});
+	suite.run("filterVoiceRelevantData", [&]() {
+		BenchmarkSuite::keep(rev2->filterVoiceRelevantData(patch));
+	});
+	suite.run("valueInPatchToText/all", [&]() {
+		for (auto const &param : parameters) {
+			BenchmarkSuite::keep(param->valueInPatchToText(*patch));
+		}
+	}, (int)parameters.size());
+
+	if (outputFile.empty()) {
+		suite.writeJson(std::cout, "midikraft-sequential-rev2", corpusFile);
+	}
+	else {
+		std::ofstream out(outputFile);
+		suite.writeJson(out, "midikraft-sequential-rev2", corpusFile);
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+#
+#  Copyright (c) 2019 Christof Ruch. All rights reserved.
+#
+#  Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+# Creates the synthetic benchmark corpus Rev2_SyntheticBank.syx from the Rev2 init patch.
+# The result is checked in, rerun only when the corpus is supposed to change:
+#
+#     python3 createCorpus.py ../../resources/Rev2_InitPatch.syx Rev2_SyntheticBank.syx
+#
+# The corpus is one bank (U1) of 128 program dumps. Every program is the init patch with different layer names,
+# A/B mode, and a deterministic walk through a few parameters, so the programs differ in name, layer mode and content.
+import sys
+
+
+def unescape(data, expected_length):
+    result = []
+    i = 0
+    while i < len(data):
+        msbs = data[i]
+        i += 1
+        for bit in range(7):
+            if i < len(data):
+                result.append(data[i] | (((msbs >> bit) & 1) << 7))
+            i += 1
+    result.extend([0] * (expected_length - len(result)))
+    return result
+
+
+def escape(data, bytes_to_escape):
+    result = []
+    i = 0
+    while i < bytes_to_escape:
+        msb_index = len(result)
+        result.append(0)
+        msbs = 0
+        for bit in range(7):
+            if i < bytes_to_escape:
+                result.append(data[i] & 0x7f)
+                msbs |= ((data[i] & 0x80) >> 7) << bit
+            i += 1
+        result[msb_index] = msbs
+    return result
+
+
+def set_name(patch, base, name):
+    name = name.ljust(20)[:20]
+    for i, c in enumerate(name):
+        patch[base + i] = ord(c)
+
+
+def main(init_patch_file, output_file):
+    with open(init_patch_file, "rb") as f:
+        init = f.read()
+    # F0 01 2F 02 <bank> <program> <escaped data> F7
+    assert init[0] == 0xf0 and init[1] == 0x01 and init[2] == 0x2f and init[3] == 0x02
+    init_patch = unescape(init[6:-1], 2048)
+
+    out = bytearray()
+    for program in range(128):
+        patch = list(init_patch)
+        for layer_offset in (0, 1024):
+            patch[layer_offset + 22] = (program * 13) % 165  # Cutoff 0..164
+            patch[layer_offset + 23] = (program * 7) % 128  # Resonance
+            patch[layer_offset + 0] = (program * 5) % 121  # Osc 1 Freq
+            patch[layer_offset + 1] = (program * 3) % 121  # Osc 2 Freq
+            patch[layer_offset + 130] = 30 + (program % 221)  # BPM 30..250
+            for step in range(64):
+                patch[layer_offset + 256 + step] = (program + step) % 128  # Poly Seq Note 1
+        patch[231] = program % 3  # A/B Mode
+        set_name(patch, 235, "Bench A %03d" % program)
+        set_name(patch, 1259, "Bench B %03d" % program if program % 4 else "Bench A %03d" % program)
+        out += bytes([0xf0, 0x01, 0x2f, 0x02, 0x00, program])
+        out += bytes(escape(patch, 2046))
+        out += bytes([0xf7])
+
+    with open(output_file, "wb") as f:
+        f.write(out)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1], sys.argv[2])